@@ -2,9 +2,215 @@
 #include <vector>
 #include <queue>
 #include <stack>
+#include <algorithm>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <cmath>
+#include <array>
+#include <thread>
+#include <fstream>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include <iterator>
+#include <cstdlib>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <climits>
+#include <cstring>
+#include <limits>
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 using namespace std;
 
+/**
+ * In-process tracing of the generate/build/query pipeline.
+ * Scoped spans are recorded into per-thread ring buffers and dumped as Chrome trace-event JSON,
+ * which chrome://tracing and Perfetto can open. Compile with GRAPH_TRACING defined to enable it,
+ * otherwise TRACE_SCOPE expands to nothing and costs nothing.
+ */
+struct TraceEvent {
+    const char* name; // The span name, must be a string literal.
+    long long start_ns; // Start time relative to the trace epoch.
+    long long duration_ns; // Duration of the span.
+};
+
+/**
+ * A fixed-capacity ring buffer of trace events owned by one thread.
+ */
+struct TraceBuffer {
+    static const size_t kCapacity = 1 << 16; // Events kept per thread, older events are overwritten.
+    int tid = 0; // The small thread number shown in the trace.
+    size_t count = 0; // The total number of events recorded.
+    vector<TraceEvent> events; // The ring of events.
+};
+
+/**
+ * All thread buffers ever created, and those whose thread has exited.
+ */
+struct TraceRegistry {
+    vector<TraceBuffer*> buffers; // Every buffer, in creation order.
+    vector<TraceBuffer*> free; // Buffers of finished threads, ready for reuse.
+};
+
+/**
+ * Returns the registry of thread buffers. Buffers are never freed, so a dump after a worker
+ * thread has finished still sees its events; instead, a finished thread's buffer is handed to the
+ * next new thread, so the number of buffers is bounded by the peak number of live threads.
+ *
+ * @param lock Receives the lock guarding the registry.
+ * @return The registry.
+ */
+inline TraceRegistry& trace_registry(unique_lock<mutex>& lock) {
+    static mutex registry_mutex;
+    static TraceRegistry registry;
+    lock = unique_lock<mutex>(registry_mutex);
+    return registry;
+}
+
+/**
+ * Returns the trace epoch, the time all event timestamps are relative to.
+ *
+ * @return The epoch.
+ */
+inline chrono::steady_clock::time_point trace_epoch() {
+    static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    return epoch;
+}
+
+/**
+ * Holds a thread's buffer and returns it to the free list when the thread exits.
+ */
+struct TraceBufferLease {
+    TraceBuffer* buffer = nullptr; // The leased buffer, nullptr until the thread records a span.
+
+    ~TraceBufferLease() {
+        if (buffer == nullptr) return;
+        unique_lock<mutex> lock;
+        trace_registry(lock).free.push_back(buffer);
+    }
+};
+
+/**
+ * Returns the calling thread's buffer, reusing a finished thread's buffer or registering a new one on first use.
+ * A reused buffer keeps its thread number and earlier events, so the trace shows it as one thread lane.
+ *
+ * @return The thread's buffer.
+ */
+inline TraceBuffer& trace_thread_buffer() {
+    thread_local TraceBufferLease lease;
+    if (lease.buffer == nullptr) {
+        unique_lock<mutex> lock;
+        TraceRegistry& registry = trace_registry(lock);
+        if (!registry.free.empty()) {
+            lease.buffer = registry.free.back();
+            registry.free.pop_back();
+        } else {
+            lease.buffer = new TraceBuffer();
+            lease.buffer->events.resize(TraceBuffer::kCapacity);
+            lease.buffer->tid = (int)registry.buffers.size() + 1;
+            registry.buffers.push_back(lease.buffer);
+        }
+    }
+    return *lease.buffer;
+}
+
+/**
+ * Records one span from its construction to its destruction.
+ */
+class TraceSpan {
+public:
+    /**
+     * Constructor for the TraceSpan class, starts the span.
+     * Reads the epoch first, so it is fixed before the outermost span starts and no start is negative.
+     *
+     * @param name The span name, must be a string literal.
+     */
+    explicit TraceSpan(const char* name) : name_(name) {
+        trace_epoch();
+        start_ = chrono::steady_clock::now();
+    }
+
+    /**
+     * Ends the span and stores it in the thread's buffer.
+     */
+    ~TraceSpan() {
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+        TraceBuffer& buffer = trace_thread_buffer();
+        TraceEvent& e = buffer.events[buffer.count % TraceBuffer::kCapacity];
+        e.name = name_;
+        e.start_ns = chrono::duration_cast<chrono::nanoseconds>(start_ - trace_epoch()).count();
+        e.duration_ns = chrono::duration_cast<chrono::nanoseconds>(end - start_).count();
+        buffer.count++;
+    }
+
+private:
+    const char* name_; // The span name.
+    chrono::steady_clock::time_point start_; // When the span started.
+};
+
+/**
+ * Writes every recorded span as Chrome trace-event JSON.
+ * Should be called when no other thread is recording.
+ *
+ * @param path The path of the file to write.
+ * @return True on success, false if the file could not be written or tracing is compiled out.
+ */
+inline bool trace_dump(const string& path) {
+#ifdef GRAPH_TRACING
+    ofstream out(path);
+    if (!out) return false;
+    unique_lock<mutex> lock;
+    const vector<TraceBuffer*>& buffers = trace_registry(lock).buffers;
+    out << fixed;
+    out.precision(3); // Microseconds with nanosecond digits, however long the trace runs.
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    for (TraceBuffer* buffer : buffers) {
+        out << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+            << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+        first = false;
+        size_t begin = buffer->count > TraceBuffer::kCapacity ? buffer->count - TraceBuffer::kCapacity : 0;
+        for (size_t i = begin; i < buffer->count; i++) {
+            const TraceEvent& e = buffer->events[i % TraceBuffer::kCapacity];
+            out << ",\n{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+                << ", \"ts\": " << e.start_ns / 1000.0 << ", \"dur\": " << e.duration_ns / 1000.0 << "}";
+        }
+    }
+    out << "\n], \"displayTimeUnit\": \"ns\"}\n";
+    return (bool)out;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#ifdef GRAPH_TRACING
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#endif
+
 /**
  * A class representing a graph.
  */
@@ -70,6 +276,37 @@ public:
      */
     void print_adj_list() const;
 
+    /**
+     * Returns the number of vertices in the graph.
+     *
+     * @return The number of vertices in the graph.
+     */
+    int get_num_vertices() const;
+
+    /**
+     * Returns whether the graph is directed.
+     *
+     * @return True if the graph is directed, false otherwise.
+     */
+    bool is_directed() const;
+
+    /**
+     * Checks whether there is an edge between two vertices without copying the adjacency matrix.
+     *
+     * @param u The starting vertex of the edge.
+     * @param v The ending vertex of the edge.
+     * @return True if the edge exists.
+     */
+    bool has_edge(int u, int v) const;
+
+    /**
+     * Returns the weight of an edge as stored in the adjacency matrix, the last weight add_edge set.
+     *
+     * @param u The starting vertex of the edge.
+     * @param v The ending vertex of the edge.
+     * @return The weight, or 0 if there is no edge.
+     */
+    int get_weight(int u, int v) const;
 
 private:
     int vertices_; // The number of vertices in the graph.
@@ -94,14 +331,28 @@ Graph::Graph(int vertices, bool directed) {
 
 /**
  * Adds an edge between two vertices in the graph.
+ * An undirected edge is listed in the adjacency lists of both endpoints, and adding an edge
+ * that already exists only updates its weight, so the list always matches the matrix.
  * @param u The index of the first vertex.
  * @param v The index of the second vertex.
  * @param weight The weight of the edge.
  */
 void Graph::add_edge(int u, int v, int weight) {
-    adj_matrix_[u][v] = weight;
-    adj_list_[u].push_back(make_pair(v, weight));
-    edges_.push_back(make_pair(u, v));
+    if (adj_matrix_[u][v] != 0) {
+        for (pair<int, int>& e : adj_list_[u]) {
+            if (e.first == v) e.second = weight;
+        }
+        if (!directed_) {
+            for (pair<int, int>& e : adj_list_[v]) {
+                if (e.first == u) e.second = weight;
+            }
+        }
+    }
+    else {
+        adj_list_[u].push_back(make_pair(v, weight));
+        if (!directed_ && u != v) adj_list_[v].push_back(make_pair(u, weight));
+        edges_.push_back(make_pair(u, v));
+    }
     if (directed_) {
         adj_matrix_[u][v] = weight;
     }
@@ -156,6 +407,7 @@ vector<vector<int>> Graph::get_inc_matrix() {
  * Prints the adjacency matrix of the graph.
  */
 void Graph::print_adj_matrix() const {
+    TRACE_SCOPE("print_adj_matrix");
     cout << "  ";
     for (int i = 0; i < vertices_; i++) { cout << "V" << i << " "; }
     cout << endl;
@@ -175,6 +427,7 @@ void Graph::print_adj_matrix() const {
  * Prints the incidence matrix of the graph.
  */
 void Graph::print_inc_matrix() const {
+    TRACE_SCOPE("print_inc_matrix");
     vector<vector<int>> inc_matrix(edges_.size(), vector<int>(vertices_, 0));
     int edge_idx = 0;
     for (int i = 0; i < vertices_; i++) {
@@ -205,6 +458,7 @@ void Graph::print_inc_matrix() const {
  * Prints the adjacency list of the graph.
  */
 void Graph::print_adj_list() const {
+    TRACE_SCOPE("print_adj_list");
     for (int i = 0; i < vertices_; i++) {
         cout << i << ": ";
         for (int j = 0; j < vertices_; j++) {
@@ -217,6 +471,42 @@ void Graph::print_adj_list() const {
     cout << endl;
 }
 
+/**
+ * Returns the number of vertices in the graph.
+ * @return The number of vertices.
+ */
+int Graph::get_num_vertices() const {
+    return vertices_;
+}
+
+/**
+ * Returns whether the graph is directed.
+ * @return True if the graph is directed.
+ */
+bool Graph::is_directed() const {
+    return directed_;
+}
+
+/**
+ * Checks whether there is an edge between two vertices.
+ * @param u The starting vertex of the edge.
+ * @param v The ending vertex of the edge.
+ * @return True if the edge exists.
+ */
+bool Graph::has_edge(int u, int v) const {
+    return adj_matrix_[u][v] != 0;
+}
+
+/**
+ * Returns the weight of an edge.
+ * @param u The starting vertex of the edge.
+ * @param v The ending vertex of the edge.
+ * @return The weight, or 0 if there is no edge.
+ */
+int Graph::get_weight(int u, int v) const {
+    return adj_matrix_[u][v];
+}
+
 /**
  * Generates a random graph with the given parameters.
  *
@@ -228,11 +518,13 @@ void Graph::print_adj_list() const {
  * @param directed Whether the graph is directed (true) or undirected (false).
  * @param max_incoming_edges The maximum number of incoming edges per vertex (if directed).
  * @param max_outgoing_edges The maximum number of outgoing edges per vertex (if directed).
+ * @param seed The seed for rand(), 0 to seed from the current time. Default is 0.
  *
  * @return A randomly generated graph with the given parameters.
  */
-Graph generate_graph(int min_vertices, int max_vertices, int min_edges, int max_edges, int max_edges_per_vertex, bool directed, int max_incoming_edges, int max_outgoing_edges) {
-    srand(time(0));
+Graph generate_graph(int min_vertices, int max_vertices, int min_edges, int max_edges, int max_edges_per_vertex, bool directed, int max_incoming_edges, int max_outgoing_edges, unsigned seed = 0) {
+    TRACE_SCOPE("generate_graph");
+    srand(seed != 0 ? seed : (unsigned)time(0));
     int num_vertices = rand() % (max_vertices - min_vertices + 1) + min_vertices;
     Graph g(num_vertices);
     int max_possible_edges = num_vertices * (num_vertices - 1) / 2;
@@ -257,7 +549,7 @@ Graph generate_graph(int min_vertices, int max_vertices, int min_edges, int max_
             continue;
         }
 
-        if (g.get_adj_matrix()[u][v] != 0) {
+        if (g.has_edge(u, v)) {
             continue;
         }
 
@@ -290,8 +582,9 @@ Graph generate_graph(int min_vertices, int max_vertices, int min_edges, int max_
  * @return A vector containing the indices of the vertices on the shortest path from source to target,
  * or an empty vector if there is no path between them.
  */
-vector<int> bfs_shortest_path(Graph g, int source, int target) {
-    int num_vertices = g.get_adj_matrix().size();
+vector<int> bfs_shortest_path(const Graph& g, int source, int target) {
+    TRACE_SCOPE("bfs_shortest_path");
+    int num_vertices = g.get_num_vertices();
     vector<int> visited(num_vertices, 0);
     vector<int> parent(num_vertices, -1);
     queue<int> q;
@@ -302,7 +595,7 @@ vector<int> bfs_shortest_path(Graph g, int source, int target) {
         int u = q.front();
         q.pop();
         for (int v = 0; v < num_vertices; v++) {
-            if (g.get_adj_matrix()[u][v] != 0 && !visited[v]) {
+            if (g.has_edge(u, v) && !visited[v]) {
                 visited[v] = 1;
                 parent[v] = u;
                 q.push(v);
@@ -335,9 +628,10 @@ and returns the shortest path from the source vertex to the target vertex, if on
 @return A vector of integers representing the vertices in the shortest path from the source to the target.
 If no path exists, an empty vector is returned.
 */
-vector<int> dfs_shortest_path(Graph g, int source, int target) {
+vector<int> dfs_shortest_path(const Graph& g, int source, int target) {
+    TRACE_SCOPE("dfs_shortest_path");
     // Initialize the necessary data structures
-    int num_vertices = g.get_adj_matrix().size();
+    int num_vertices = g.get_num_vertices();
     vector<int> visited(num_vertices, 0);
     vector<int> parent(num_vertices, -1);
     stack<int> s;
@@ -349,7 +643,7 @@ vector<int> dfs_shortest_path(Graph g, int source, int target) {
         int u = s.top();
         s.pop();
         for (int v = 0; v < num_vertices; v++) {
-            if (g.get_adj_matrix()[u][v] != 0 && !visited[v]) {
+            if (g.has_edge(u, v) && !visited[v]) {
                 visited[v] = 1;
                 parent[v] = u;
                 s.push(v);
@@ -377,72 +671,6711 @@ vector<int> dfs_shortest_path(Graph g, int source, int target) {
     }
 }
 
-int main() {
-    srand(time(0));
-    int min_vertices = 10;
-    int max_vertices = 10;
-    int min_edges = 10;
-    int max_edges = 10;
-    int max_edges_per_vertex = 10;
-    int num_graphs = 10;
-    int source = 0;
-    int target = 0;
+/**
+ * A compressed sparse row (CSR) snapshot of a graph.
+ * The neighbours of vertex u are targets[offsets[u]] .. targets[offsets[u + 1] - 1].
+ */
+struct CsrGraph {
+    int vertices = 0; // The number of vertices in the graph.
+    bool directed = false; // Whether the graph is directed or undirected.
+    vector<int> offsets; // Row offsets, vertices + 1 entries.
+    vector<int> targets; // Neighbour vertices, grouped by source vertex.
+    vector<int> weights; // Edge weights, parallel to targets.
 
+    /**
+     * Returns the number of neighbours of a vertex.
+     *
+     * @param u The index of the vertex.
+     * @return The out-degree of u.
+     */
+    int degree(int u) const { return offsets[u + 1] - offsets[u]; }
 
-    for (int i = 0; i < num_graphs; i++) {
+    /**
+     * Returns the number of vertices. Part of the view interface used by the traversal templates.
+     *
+     * @return The number of vertices.
+     */
+    int num_vertices() const { return vertices; }
 
-        int num_vertices = rand() % (max_vertices - min_vertices + 1) + min_vertices;
-        int num_edges = rand() % (max_edges - min_edges + 1) + min_edges;
-        Graph g = generate_graph(min_vertices, max_vertices, min_edges, max_edges, max_edges_per_vertex, false, 1, 1);
-        source = rand() % num_vertices;
-        target = rand() % num_vertices;
+    /**
+     * Calls f(v, weight) for every neighbour v of u. Part of the view interface used by the traversal templates.
+     *
+     * @param u The index of the vertex.
+     * @param f The function to call.
+     */
+    template <typename F>
+    void for_each_neighbor(int u, F f) const {
+        for (int i = offsets[u]; i < offsets[u + 1]; i++) f(targets[i], weights[i]);
+    }
+};
 
+/**
+ * Builds a CSR snapshot of the graph from its adjacency list.
+ * For undirected graphs every edge is stored in both directions.
+ *
+ * @param g The graph to convert.
+ * @return The CSR representation of the graph.
+ */
+CsrGraph build_csr(Graph& g) {
+    TRACE_SCOPE("build_csr");
+    CsrGraph csr;
+    csr.vertices = g.get_num_vertices();
+    csr.directed = g.is_directed();
+    vector<vector<pair<int, int>>> adj_list = g.get_adj_list();
 
+    // The adjacency list of an undirected graph already holds both directions of every edge.
+    csr.offsets.assign(csr.vertices + 1, 0);
+    for (int u = 0; u < csr.vertices; u++) {
+        csr.offsets[u + 1] = csr.offsets[u] + (int)adj_list[u].size();
+    }
 
-        cout << "Adjacency matrix:" << endl;
-        g.print_adj_matrix();
+    csr.targets.resize(csr.offsets[csr.vertices]);
+    csr.weights.resize(csr.offsets[csr.vertices]);
+    for (int u = 0; u < csr.vertices; u++) {
+        int cursor = csr.offsets[u];
+        for (const pair<int, int>& e : adj_list[u]) {
+            csr.targets[cursor] = e.first;
+            csr.weights[cursor++] = e.second;
+        }
+    }
+    return csr;
+}
 
-        cout << "Incidence matrix:" << endl;
-        g.print_inc_matrix();
+/**
+ * An arbitrary precision unsigned integer used to count shortest paths.
+ * The number of shortest paths grows exponentially with the distance, so it can not be kept in an int.
+ */
+class PathCount {
+public:
+    /**
+     * Constructor for the PathCount class.
+     *
+     * @param value The initial value. Default is 0.
+     */
+    PathCount(uint32_t value = 0);
 
-        cout << "Adjacency list:" << endl;
-        g.print_adj_list();
+    /**
+     * Adds another count to this one.
+     *
+     * @param other The count to add.
+     */
+    void add(const PathCount& other);
 
-        cout << "Graph " << i + 1 << " with " << num_vertices << " vertices and " << num_edges << " edges" << endl;
-        clock_t start_bfs = clock();
-        vector<int> bfs_path = bfs_shortest_path(g, source, target);
-        clock_t end_bfs = clock();
-        double time_bfs = (double)(end_bfs - start_bfs) / CLOCKS_PER_SEC;
-        cout << "BFS shortest path from vertex " << source << " to vertex " << target << ": ";
-        if (!bfs_path.empty()) {
-            for (int j = 0; j < bfs_path.size(); j++) {
-                cout << bfs_path[j] << " ";
-            }
-            cout << endl;
-        }
-        else {
-            cout << "Path does not exist" << endl;
+    /**
+     * Subtracts a smaller or equal count from this one.
+     *
+     * @param other The count to subtract.
+     */
+    void subtract(const PathCount& other);
+
+    /**
+     * Compares two counts.
+     *
+     * @param other The count to compare with.
+     * @return True if this count is less than other.
+     */
+    bool less(const PathCount& other) const;
+
+    /**
+     * Returns whether the count is zero.
+     *
+     * @return True if the count is zero.
+     */
+    bool is_zero() const;
+
+    /**
+     * Returns a uniformly distributed random value in [0, this).
+     *
+     * @param rng The random number generator to use.
+     * @return A random count less than this one.
+     */
+    PathCount random_below(mt19937& rng) const;
+
+    /**
+     * Returns the decimal representation of the count.
+     *
+     * @return The count as a decimal string.
+     */
+    string to_string() const;
+
+private:
+    vector<uint32_t> limbs_; // Base 2^32 digits, least significant first, no leading zeros.
+
+    /**
+     * Removes leading zero limbs.
+     */
+    void trim();
+};
+
+/**
+ * Constructor for the PathCount class.
+ * @param value The initial value.
+ */
+PathCount::PathCount(uint32_t value) {
+    if (value != 0) limbs_.push_back(value);
+}
+
+/**
+ * Adds another count to this one.
+ * @param other The count to add.
+ */
+void PathCount::add(const PathCount& other) {
+    if (limbs_.size() < other.limbs_.size()) limbs_.resize(other.limbs_.size(), 0);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < limbs_.size(); i++) {
+        uint64_t sum = carry + limbs_[i] + (i < other.limbs_.size() ? other.limbs_[i] : 0);
+        limbs_[i] = (uint32_t)sum;
+        carry = sum >> 32;
+        if (carry == 0 && i >= other.limbs_.size()) break;
+    }
+    if (carry != 0) limbs_.push_back((uint32_t)carry);
+}
+
+/**
+ * Subtracts a smaller or equal count from this one.
+ * @param other The count to subtract.
+ */
+void PathCount::subtract(const PathCount& other) {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < limbs_.size(); i++) {
+        int64_t diff = (int64_t)limbs_[i] - borrow - (i < other.limbs_.size() ? other.limbs_[i] : 0);
+        borrow = diff < 0 ? 1 : 0;
+        limbs_[i] = (uint32_t)(diff + (borrow << 32));
+    }
+    trim();
+}
+
+/**
+ * Compares two counts.
+ * @param other The count to compare with.
+ * @return True if this count is less than other.
+ */
+bool PathCount::less(const PathCount& other) const {
+    if (limbs_.size() != other.limbs_.size()) return limbs_.size() < other.limbs_.size();
+    for (size_t i = limbs_.size(); i-- > 0;) {
+        if (limbs_[i] != other.limbs_[i]) return limbs_[i] < other.limbs_[i];
+    }
+    return false;
+}
+
+/**
+ * Returns whether the count is zero.
+ * @return True if the count is zero.
+ */
+bool PathCount::is_zero() const {
+    return limbs_.empty();
+}
+
+/**
+ * Returns a uniformly distributed random value in [0, this) using rejection sampling.
+ * @param rng The random number generator to use.
+ * @return A random count less than this one.
+ */
+PathCount PathCount::random_below(mt19937& rng) const {
+    PathCount r;
+    if (limbs_.empty()) return r;
+    uint32_t top = limbs_.back();
+    uint32_t mask = top;
+    mask |= mask >> 1; mask |= mask >> 2; mask |= mask >> 4; mask |= mask >> 8; mask |= mask >> 16;
+    do {
+        r.limbs_.resize(limbs_.size());
+        for (size_t i = 0; i + 1 < limbs_.size(); i++) r.limbs_[i] = (uint32_t)rng();
+        r.limbs_.back() = (uint32_t)rng() & mask;
+        r.trim();
+    } while (!r.less(*this));
+    return r;
+}
+
+/**
+ * Returns the decimal representation of the count.
+ * @return The count as a decimal string.
+ */
+string PathCount::to_string() const {
+    if (limbs_.empty()) return "0";
+    vector<uint32_t> value = limbs_;
+    vector<uint32_t> chunks; // Base 10^9 digits, least significant first.
+    while (!value.empty()) {
+        uint64_t rem = 0;
+        for (size_t i = value.size(); i-- > 0;) {
+            uint64_t cur = (rem << 32) | value[i];
+            value[i] = (uint32_t)(cur / 1000000000);
+            rem = cur % 1000000000;
         }
-        cout << "BFS shortest path time: " << time_bfs << " seconds" << endl;
+        chunks.push_back((uint32_t)rem);
+        while (!value.empty() && value.back() == 0) value.pop_back();
+    }
+    string result = std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        string part = std::to_string(chunks[i]);
+        result += string(9 - part.size(), '0') + part;
+    }
+    return result;
+}
 
-        clock_t start_dfs = clock();
-        vector<int> dfs_path = dfs_shortest_path(g, source, target);
-        clock_t end_dfs = clock();
-        double time_dfs = (double)(end_dfs - start_dfs) / CLOCKS_PER_SEC;
+/**
+ * Removes leading zero limbs.
+ */
+void PathCount::trim() {
+    while (!limbs_.empty() && limbs_.back() == 0) limbs_.pop_back();
+}
 
-        cout << "DFS shortest path from vertex " << source << " to vertex " << target << ": ";
-        if (!dfs_path.empty()) {
-            for (int j = 0; j < dfs_path.size(); j++) {
-                cout << dfs_path[j] << " ";
+/**
+ * The shortest-path DAG of a graph rooted at a source vertex.
+ * Every edge u->v with dist[u] + 1 == dist[v] is kept as a predecessor link of v.
+ */
+struct ShortestPathDag {
+    int source = -1; // The root of the DAG.
+    vector<int> dist; // Hop distance from the source, -1 if unreachable.
+    vector<PathCount> counts; // Number of distinct shortest paths from the source.
+    vector<int> pred_offsets; // CSR offsets into preds, vertices + 1 entries.
+    vector<int> preds; // Shortest-path predecessors, grouped by vertex.
+};
+
+/**
+ * Computes the shortest-path DAG from the given source vertex with a single BFS.
+ *
+ * @param csr The graph to search.
+ * @param source The index of the source vertex.
+ * @return The shortest-path DAG with per-vertex path counts and a predecessor CSR.
+ */
+ShortestPathDag build_shortest_path_dag(const CsrGraph& csr, int source) {
+    TRACE_SCOPE("build_shortest_path_dag");
+    ShortestPathDag dag;
+    dag.source = source;
+    dag.dist.assign(csr.vertices, -1);
+    dag.counts.assign(csr.vertices, PathCount());
+    dag.pred_offsets.assign(csr.vertices + 1, 0);
+
+    vector<int> order; // Vertices in BFS order, doubles as the queue.
+    order.reserve(csr.vertices);
+    order.push_back(source);
+    dag.dist[source] = 0;
+    dag.counts[source] = PathCount(1);
+    for (size_t head = 0; head < order.size(); head++) {
+        int u = order[head];
+        for (int i = csr.offsets[u]; i < csr.offsets[u + 1]; i++) {
+            int v = csr.targets[i];
+            if (dag.dist[v] == -1) {
+                dag.dist[v] = dag.dist[u] + 1;
+                order.push_back(v);
+            }
+            if (dag.dist[v] == dag.dist[u] + 1) {
+                dag.counts[v].add(dag.counts[u]);
+                dag.pred_offsets[v + 1]++;
             }
-            cout << endl;
         }
-        else {
-            cout << "Path does not exist" << endl;
+    }
+
+    for (int v = 0; v < csr.vertices; v++) {
+        dag.pred_offsets[v + 1] += dag.pred_offsets[v];
+    }
+    dag.preds.resize(dag.pred_offsets[csr.vertices]);
+    vector<int> cursor(dag.pred_offsets.begin(), dag.pred_offsets.end() - 1);
+    for (int u : order) {
+        for (int i = csr.offsets[u]; i < csr.offsets[u + 1]; i++) {
+            int v = csr.targets[i];
+            if (dag.dist[v] == dag.dist[u] + 1) {
+                dag.preds[cursor[v]++] = u;
+            }
         }
-        cout << "DFS shortest path time: " << time_dfs << " seconds ";
-        cout << endl << endl << endl;
+    }
+    return dag;
+}
 
+/**
+ * Lazily enumerates all shortest paths from the DAG source to a target vertex.
+ * Only the current path and one cursor per level are kept in memory.
+ */
+class ShortestPathEnumerator {
+public:
+    /**
+     * Constructor for the ShortestPathEnumerator class.
+     *
+     * @param dag The shortest-path DAG to enumerate. Must outlive the enumerator.
+     * @param target The index of the target vertex.
+     */
+    ShortestPathEnumerator(const ShortestPathDag& dag, int target);
+
+    /**
+     * Produces the next shortest path.
+     *
+     * @param path Receives the vertices of the path from source to target.
+     * @return True if a path was produced, false if all paths have been enumerated.
+     */
+    bool next(vector<int>& path);
+
+private:
+    const ShortestPathDag& dag_; // The DAG being enumerated.
+    vector<int> stack_; // Vertices of the current path, from target towards source.
+    vector<int> cursor_; // Index into preds of the predecessor chosen at each level.
+    bool started_; // Whether the first path has been produced.
+    bool done_; // Whether the enumeration has finished.
+
+    /**
+     * Extends the current partial path down to the source along the first predecessors.
+     */
+    void descend();
+};
+
+/**
+ * Constructor for the ShortestPathEnumerator class.
+ * @param dag The shortest-path DAG to enumerate.
+ * @param target The index of the target vertex.
+ */
+ShortestPathEnumerator::ShortestPathEnumerator(const ShortestPathDag& dag, int target) : dag_(dag) {
+    started_ = false;
+    done_ = dag.dist[target] == -1;
+    if (!done_) {
+        stack_.push_back(target);
+        cursor_.push_back(dag.pred_offsets[target]);
+    }
+}
+
+/**
+ * Extends the current partial path down to the source along the first predecessors.
+ */
+void ShortestPathEnumerator::descend() {
+    while (stack_.back() != dag_.source) {
+        int u = dag_.preds[cursor_.back()];
+        stack_.push_back(u);
+        cursor_.push_back(dag_.pred_offsets[u]);
+    }
+}
+
+/**
+ * Produces the next shortest path.
+ * @param path Receives the vertices of the path from source to target.
+ * @return True if a path was produced.
+ */
+bool ShortestPathEnumerator::next(vector<int>& path) {
+    if (done_) return false;
+    if (started_) {
+        // Backtrack to the deepest level that still has an unexplored predecessor.
+        stack_.pop_back();
+        cursor_.pop_back();
+        while (!stack_.empty()) {
+            int v = stack_.back();
+            if (++cursor_.back() < dag_.pred_offsets[v + 1]) break;
+            stack_.pop_back();
+            cursor_.pop_back();
+        }
+        if (stack_.empty()) {
+            done_ = true;
+            return false;
+        }
+    }
+    started_ = true;
+    descend();
+    path.assign(stack_.rbegin(), stack_.rend());
+    return true;
+}
+
+/**
+ * Samples one shortest path uniformly at random among all shortest paths to the target.
+ * Each predecessor p of v is chosen with probability counts[p] / counts[v].
+ *
+ * @param dag The shortest-path DAG to sample from.
+ * @param target The index of the target vertex.
+ * @param rng The random number generator to use.
+ * @return The vertices of the sampled path from source to target, or an empty vector if unreachable.
+ */
+vector<int> sample_shortest_path(const ShortestPathDag& dag, int target, mt19937& rng) {
+    vector<int> path;
+    if (dag.dist[target] == -1) return path;
+    int v = target;
+    path.push_back(v);
+    while (v != dag.source) {
+        PathCount r = dag.counts[v].random_below(rng);
+        int chosen = dag.preds[dag.pred_offsets[v + 1] - 1];
+        for (int i = dag.pred_offsets[v]; i < dag.pred_offsets[v + 1]; i++) {
+            int p = dag.preds[i];
+            if (r.less(dag.counts[p])) {
+                chosen = p;
+                break;
+            }
+            r.subtract(dag.counts[p]);
+        }
+        v = chosen;
+        path.push_back(v);
+    }
+    reverse(path.begin(), path.end());
+    return path;
+}
+
+/**
+ * Parameters for building a Thorup-Zwick distance oracle.
+ */
+struct TzOracleOptions {
+    int k = 2; // Stretch parameter, the oracle answers within a factor of 2k - 1.
+    size_t memory_target = 0; // If non-zero, the smallest k whose expected size fits in this many bytes is used instead.
+    unsigned seed = 1; // Seed for sampling the vertex hierarchy.
+    int threads = 0; // Number of construction threads, 0 means hardware concurrency.
+};
+
+/**
+ * A Thorup-Zwick approximate distance oracle for hop distances in undirected graphs.
+ * Vertices are sampled into a hierarchy V = A_0 > A_1 > ... > A_k = {}, every vertex keeps
+ * its nearest pivot on each level and a bunch of nearby sampled vertices with exact distances.
+ * A query walks at most k levels and returns an estimate d with dist(u, v) <= d <= (2k - 1) * dist(u, v).
+ */
+class TzOracle {
+public:
+    /**
+     * Builds the oracle for the given graph.
+     *
+     * @param csr The undirected graph to index.
+     * @param options The construction parameters.
+     */
+    void build(const CsrGraph& csr, const TzOracleOptions& options);
+
+    /**
+     * Returns an approximate hop distance between two vertices.
+     *
+     * @param u The index of the first vertex.
+     * @param v The index of the second vertex.
+     * @return The estimated distance, or -1 if the vertices are not connected.
+     */
+    int query(int u, int v) const;
+
+    /**
+     * Returns the stretch parameter the oracle was built with.
+     *
+     * @return The number of levels k.
+     */
+    int get_k() const;
+
+    /**
+     * Returns the total number of bunch entries stored by the oracle.
+     *
+     * @return The number of (vertex, distance) pairs in all bunches.
+     */
+    size_t get_bunch_size() const;
+
+    /**
+     * Writes the oracle to a binary file.
+     *
+     * @param path The path of the file to write, usually next to the graph file.
+     * @return True on success, false if the file could not be written.
+     */
+    bool save(const string& path) const;
+
+    /**
+     * Reads an oracle previously written by save.
+     *
+     * @param path The path of the file to read.
+     * @return True on success, false if the file could not be read or is malformed.
+     */
+    bool load(const string& path);
+
+private:
+    int vertices_ = 0; // The number of vertices in the indexed graph.
+    int k_ = 0; // The number of levels.
+    vector<vector<int>> pivot_; // pivot_[i][v] is the nearest vertex of A_i to v, -1 if none.
+    vector<vector<int>> pivot_dist_; // pivot_dist_[i][v] is the distance from v to pivot_[i][v].
+    vector<int> bunch_offsets_; // CSR offsets into the bunch arrays, vertices + 1 entries.
+    vector<int> bunch_vertices_; // Bunch members of each vertex, sorted by vertex index.
+    vector<int> bunch_dists_; // Exact distances to the bunch members.
+
+    /**
+     * Looks up the exact distance from v to w if w is in the bunch of v.
+     *
+     * @param v The vertex whose bunch is searched.
+     * @param w The bunch member to look for.
+     * @return The distance from v to w, or -1 if w is not in the bunch of v.
+     */
+    int bunch_dist(int v, int w) const;
+
+    /**
+     * Reads the arrays of an oracle file and checks them against each other.
+     *
+     * @param path The path of the file to read.
+     * @return True if the file is complete and consistent.
+     */
+    bool load_arrays(const string& path);
+};
+
+/**
+ * Builds the oracle for the given graph.
+ * @param csr The undirected graph to index.
+ * @param options The construction parameters.
+ */
+void TzOracle::build(const CsrGraph& csr, const TzOracleOptions& options) {
+    TRACE_SCOPE("TzOracle::build");
+    vertices_ = csr.vertices;
+    int n = max(vertices_, 2);
+    k_ = max(options.k, 1);
+    if (options.memory_target > 0) {
+        // Expected size is about k * n^(1 + 1/k) bunch entries of two ints each.
+        // Beyond log2(n) levels the size stops shrinking, so that is used when nothing fits.
+        int max_k = max(1, (int)ceil(log2((double)n)));
+        for (k_ = 1; k_ < max_k; k_++) {
+            double entries = k_ * pow((double)n, 1.0 + 1.0 / k_);
+            if (entries * 2 * sizeof(int) <= (double)options.memory_target) break;
+        }
+    }
+
+    // Sample the hierarchy, level[v] is the highest i with v in A_i.
+    mt19937 rng(options.seed);
+    uniform_real_distribution<double> coin(0.0, 1.0);
+    double p = pow((double)n, -1.0 / k_);
+    vector<int> level(vertices_, 0);
+    for (int v = 0; v < vertices_; v++) {
+        while (level[v] + 1 < k_ && coin(rng) < p) level[v]++;
+    }
+
+    // Nearest pivot on every level with a multi-source BFS from A_i.
+    pivot_.assign(k_ + 1, vector<int>(vertices_, -1));
+    pivot_dist_.assign(k_ + 1, vector<int>(vertices_, -1));
+    for (int i = 0; i < k_; i++) {
+        vector<int> queue;
+        for (int v = 0; v < vertices_; v++) {
+            if (level[v] >= i) {
+                pivot_[i][v] = v;
+                pivot_dist_[i][v] = 0;
+                queue.push_back(v);
+            }
+        }
+        for (size_t head = 0; head < queue.size(); head++) {
+            int u = queue[head];
+            for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                int v = csr.targets[e];
+                if (pivot_dist_[i][v] == -1) {
+                    pivot_dist_[i][v] = pivot_dist_[i][u] + 1;
+                    pivot_[i][v] = pivot_[i][u];
+                    queue.push_back(v);
+                }
+            }
+        }
+    }
+
+    // Clusters: w in A_i \ A_{i+1} reaches every v with d(w, v) < d(v, A_{i+1}).
+    // Every thread grows the clusters of a strided share of the centers and collects (v, w, d) triples.
+    int threads = options.threads > 0 ? options.threads : max(1, (int)thread::hardware_concurrency());
+    vector<vector<array<int, 3>>> found(threads);
+    auto grow_clusters = [&](int t) {
+        TRACE_SCOPE("TzOracle::build/clusters");
+        vector<int> dist(vertices_, -1);
+        vector<int> queue;
+        for (int w = t; w < vertices_; w += threads) {
+            int i = level[w];
+            const vector<int>& limit = pivot_dist_[i + 1];
+            queue.assign(1, w);
+            dist[w] = 0;
+            for (size_t head = 0; head < queue.size(); head++) {
+                int u = queue[head];
+                found[t].push_back({ u, w, dist[u] });
+                for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                    int v = csr.targets[e];
+                    if (dist[v] == -1 && (limit[v] == -1 || dist[u] + 1 < limit[v])) {
+                        dist[v] = dist[u] + 1;
+                        queue.push_back(v);
+                    }
+                }
+            }
+            for (int u : queue) dist[u] = -1;
+        }
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) pool.emplace_back(grow_clusters, t);
+    grow_clusters(0);
+    for (thread& th : pool) th.join();
+
+    bunch_offsets_.assign(vertices_ + 1, 0);
+    for (const vector<array<int, 3>>& part : found) {
+        for (const array<int, 3>& f : part) bunch_offsets_[f[0] + 1]++;
+    }
+    for (int v = 0; v < vertices_; v++) bunch_offsets_[v + 1] += bunch_offsets_[v];
+    bunch_vertices_.resize(bunch_offsets_[vertices_]);
+    bunch_dists_.resize(bunch_offsets_[vertices_]);
+    vector<pair<int, int>> entries(bunch_offsets_[vertices_]);
+    vector<int> cursor(bunch_offsets_.begin(), bunch_offsets_.end() - 1);
+    for (const vector<array<int, 3>>& part : found) {
+        for (const array<int, 3>& f : part) entries[cursor[f[0]]++] = make_pair(f[1], f[2]);
+    }
+    for (int v = 0; v < vertices_; v++) {
+        sort(entries.begin() + bunch_offsets_[v], entries.begin() + bunch_offsets_[v + 1]);
+    }
+    for (size_t j = 0; j < entries.size(); j++) {
+        bunch_vertices_[j] = entries[j].first;
+        bunch_dists_[j] = entries[j].second;
+    }
+}
+
+/**
+ * Looks up the exact distance from v to w if w is in the bunch of v.
+ * @param v The vertex whose bunch is searched.
+ * @param w The bunch member to look for.
+ * @return The distance, or -1 if w is not in the bunch.
+ */
+int TzOracle::bunch_dist(int v, int w) const {
+    vector<int>::const_iterator first = bunch_vertices_.begin() + bunch_offsets_[v];
+    vector<int>::const_iterator last = bunch_vertices_.begin() + bunch_offsets_[v + 1];
+    vector<int>::const_iterator it = lower_bound(first, last, w);
+    if (it == last || *it != w) return -1;
+    return bunch_dists_[it - bunch_vertices_.begin()];
+}
+
+/**
+ * Returns an approximate hop distance between two vertices.
+ * @param u The index of the first vertex.
+ * @param v The index of the second vertex.
+ * @return The estimated distance, or -1 if the vertices are not connected.
+ */
+int TzOracle::query(int u, int v) const {
+    int w = u;
+    int i = 0;
+    int d = bunch_dist(v, w);
+    while (d == -1) {
+        i++;
+        if (i >= k_) return -1;
+        swap(u, v);
+        w = pivot_[i][u];
+        if (w == -1) return -1;
+        d = bunch_dist(v, w);
+    }
+    return pivot_dist_[i][u] + d;
+}
+
+/**
+ * Returns the stretch parameter the oracle was built with.
+ * @return The number of levels k.
+ */
+int TzOracle::get_k() const {
+    return k_;
+}
+
+/**
+ * Returns the total number of bunch entries stored by the oracle.
+ * @return The number of bunch entries.
+ */
+size_t TzOracle::get_bunch_size() const {
+    return bunch_vertices_.size();
+}
+
+/**
+ * Writes a vector of ints to a binary stream, prefixed by its length.
+ * @param out The stream to write to.
+ * @param values The values to write.
+ */
+static void write_int_vector(ofstream& out, const vector<int>& values) {
+    uint64_t size = values.size();
+    out.write((const char*)&size, sizeof(size));
+    if (size > 0) out.write((const char*)values.data(), size * sizeof(int));
+}
+
+/**
+ * Reads a length-prefixed vector of ints from a binary stream.
+ * A length longer than the rest of the stream is rejected before anything is allocated.
+ * @param in The stream to read from.
+ * @param values Receives the values.
+ * @return True on success.
+ */
+static bool read_int_vector(ifstream& in, vector<int>& values) {
+    uint64_t size = 0;
+    if (!in.read((char*)&size, sizeof(size))) return false;
+    streampos here = in.tellg();
+    in.seekg(0, ios::end);
+    streampos end = in.tellg();
+    in.seekg(here);
+    if (!in || size > (uint64_t)(end - here) / sizeof(int)) return false;
+    values.resize(size);
+    if (size > 0) in.read((char*)values.data(), size * sizeof(int));
+    return (bool)in;
+}
+
+/**
+ * Writes the oracle to a binary file.
+ * @param path The path of the file to write.
+ * @return True on success.
+ */
+bool TzOracle::save(const string& path) const {
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+    const char magic[4] = { 'T', 'Z', 'O', '1' };
+    out.write(magic, sizeof(magic));
+    out.write((const char*)&vertices_, sizeof(vertices_));
+    out.write((const char*)&k_, sizeof(k_));
+    for (int i = 0; i < k_; i++) {
+        write_int_vector(out, pivot_[i]);
+        write_int_vector(out, pivot_dist_[i]);
+    }
+    write_int_vector(out, bunch_offsets_);
+    write_int_vector(out, bunch_vertices_);
+    write_int_vector(out, bunch_dists_);
+    return (bool)out;
+}
+
+/**
+ * Reads an oracle previously written by save.
+ * Every array is checked against the header, so that query never reads out of bounds;
+ * on failure the oracle is left empty.
+ * @param path The path of the file to read.
+ * @return True on success.
+ */
+bool TzOracle::load(const string& path) {
+    bool ok = load_arrays(path);
+    if (!ok) {
+        vertices_ = k_ = 0;
+        pivot_.clear();
+        pivot_dist_.clear();
+        bunch_offsets_.clear();
+        bunch_vertices_.clear();
+        bunch_dists_.clear();
+    }
+    return ok;
+}
+
+/**
+ * Reads and validates the arrays of an oracle file.
+ * @param path The path of the file to read.
+ * @return True if the file is complete and consistent.
+ */
+bool TzOracle::load_arrays(const string& path) {
+    ifstream in(path, ios::binary);
+    char magic[4];
+    if (!in.read(magic, sizeof(magic)) || string(magic, 4) != "TZO1") return false;
+    in.read((char*)&vertices_, sizeof(vertices_));
+    in.read((char*)&k_, sizeof(k_));
+    if (!in || vertices_ < 0 || k_ < 1) return false;
+    // Every level holds two length-prefixed arrays, which bounds k by the file size before allocating.
+    streampos here = in.tellg();
+    in.seekg(0, ios::end);
+    uint64_t rest = (uint64_t)(in.tellg() - here);
+    in.seekg(here);
+    if ((uint64_t)k_ > rest / (2 * sizeof(uint64_t))) return false;
+    pivot_.assign(k_ + 1, vector<int>());
+    pivot_dist_.assign(k_ + 1, vector<int>());
+    for (int i = 0; i < k_; i++) {
+        if (!read_int_vector(in, pivot_[i]) || !read_int_vector(in, pivot_dist_[i])) return false;
+        if (pivot_[i].size() != (size_t)vertices_ || pivot_dist_[i].size() != (size_t)vertices_) return false;
+        for (int p : pivot_[i]) if (p < -1 || p >= vertices_) return false;
+    }
+    pivot_[k_].assign(vertices_, -1);
+    pivot_dist_[k_].assign(vertices_, -1);
+    if (!read_int_vector(in, bunch_offsets_) || !read_int_vector(in, bunch_vertices_) || !read_int_vector(in, bunch_dists_)) return false;
+    if (bunch_offsets_.size() != (size_t)vertices_ + 1 || bunch_offsets_[0] != 0) return false;
+    if ((size_t)bunch_offsets_[vertices_] != bunch_vertices_.size() || bunch_vertices_.size() != bunch_dists_.size()) return false;
+    for (int v = 0; v < vertices_; v++) {
+        if (bunch_offsets_[v + 1] < bunch_offsets_[v]) return false;
+        // Rows must be sorted for the binary search in bunch_dist.
+        for (int e = bunch_offsets_[v]; e < bunch_offsets_[v + 1]; e++) {
+            if (bunch_vertices_[e] < 0 || bunch_vertices_[e] >= vertices_) return false;
+            if (e > bunch_offsets_[v] && bunch_vertices_[e] <= bunch_vertices_[e - 1]) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Lower and upper bounds on the hop distance between two vertices.
+ */
+struct DistanceBounds {
+    int lower = 0; // The distance is at least this value.
+    int upper = -1; // The distance is at most this value, -1 if no landmark gives a bound.
+};
+
+const uint8_t kUnknownLandmarkDist = 255; // Marks an unreachable landmark or a distance that does not fit in a byte.
+
+/**
+ * Landmark distance sketches for approximate hop distances in undirected graphs.
+ * Every vertex stores its distance to each of k landmarks as one byte, laid out vertex-major
+ * so that a query reads two contiguous rows. The triangle inequality through the landmarks
+ * then bounds the distance from both sides.
+ */
+class LandmarkSketch {
+public:
+    /**
+     * Builds the sketch by running one BFS per landmark.
+     *
+     * @param csr The undirected graph to index.
+     * @param num_landmarks The number of landmarks k.
+     * @param by_degree Whether to pick the highest degree vertices (true) or random vertices (false).
+     * @param seed Seed for random landmark selection.
+     * @param threads Number of BFS threads, 0 means hardware concurrency.
+     */
+    void build(const CsrGraph& csr, int num_landmarks, bool by_degree = true, unsigned seed = 1, int threads = 0);
+
+    /**
+     * Returns lower and upper bounds on the distance between two vertices in O(k).
+     *
+     * @param u The index of the first vertex.
+     * @param v The index of the second vertex.
+     * @return The distance bounds.
+     */
+    DistanceBounds bounds(int u, int v) const;
+
+    /**
+     * Returns the exact distance, using the sketch bounds to limit a bidirectional BFS.
+     *
+     * @param csr The graph the sketch was built for.
+     * @param u The index of the first vertex.
+     * @param v The index of the second vertex.
+     * @return The exact hop distance, or -1 if the vertices are not connected.
+     */
+    int exact_distance(const CsrGraph& csr, int u, int v) const;
+
+    /**
+     * Returns the chosen landmarks.
+     *
+     * @return The landmark vertices.
+     */
+    const vector<int>& get_landmarks() const;
+
+private:
+    int vertices_ = 0; // The number of vertices in the indexed graph.
+    int stride_ = 0; // Bytes per vertex row, the number of landmarks rounded up to 16.
+    vector<int> landmarks_; // The landmark vertices.
+    vector<uint8_t> dist_; // dist_[v * stride_ + l] is the distance from v to landmark l.
+};
+
+/**
+ * Runs a bidirectional BFS that gives up once the distance would exceed a limit.
+ *
+ * @param csr The undirected graph to search.
+ * @param source The index of the source vertex.
+ * @param target The index of the target vertex.
+ * @param limit The maximum distance to search for, -1 for no limit.
+ * @return The hop distance, or -1 if the target is not reachable within the limit.
+ */
+int bounded_bidirectional_bfs(const CsrGraph& csr, int source, int target, int limit) {
+    if (source == target) return 0;
+    // side[v] is 1 if reached from the source, 2 if reached from the target.
+    vector<uint8_t> side(csr.vertices, 0);
+    vector<int> dist(csr.vertices, 0);
+    vector<int> frontier[2] = { vector<int>(1, source), vector<int>(1, target) };
+    side[source] = 1;
+    side[target] = 2;
+    int depth[2] = { 0, 0 };
+    while (!frontier[0].empty() && !frontier[1].empty()) {
+        if (limit >= 0 && depth[0] + depth[1] >= limit) return -1;
+        // Expand the side with the smaller frontier.
+        int s = frontier[0].size() <= frontier[1].size() ? 0 : 1;
+        int best = -1;
+        vector<int> next;
+        for (int u : frontier[s]) {
+            for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                int v = csr.targets[e];
+                if (side[v] == 0) {
+                    side[v] = (uint8_t)(s + 1);
+                    dist[v] = dist[u] + 1;
+                    next.push_back(v);
+                }
+                else if (side[v] != s + 1) {
+                    int d = dist[u] + 1 + dist[v];
+                    if (best == -1 || d < best) best = d;
+                }
+            }
+        }
+        if (best != -1) return best;
+        depth[s]++;
+        frontier[s].swap(next);
+    }
+    return -1;
+}
+
+/**
+ * Builds the sketch by running one BFS per landmark.
+ * @param csr The undirected graph to index.
+ * @param num_landmarks The number of landmarks.
+ * @param by_degree Whether to pick the highest degree vertices.
+ * @param seed Seed for random landmark selection.
+ * @param threads Number of BFS threads.
+ */
+void LandmarkSketch::build(const CsrGraph& csr, int num_landmarks, bool by_degree, unsigned seed, int threads) {
+    TRACE_SCOPE("LandmarkSketch::build");
+    vertices_ = csr.vertices;
+    vector<int> order(vertices_);
+    for (int v = 0; v < vertices_; v++) order[v] = v;
+    if (by_degree) {
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return csr.degree(a) > csr.degree(b); });
+    }
+    else {
+        mt19937 rng(seed);
+        shuffle(order.begin(), order.end(), rng);
+    }
+    landmarks_.assign(order.begin(), order.begin() + min(num_landmarks, vertices_));
+    int k = (int)landmarks_.size();
+    stride_ = max(16, (k + 15) / 16 * 16);
+    dist_.assign((size_t)vertices_ * stride_, kUnknownLandmarkDist);
+
+    if (threads <= 0) threads = max(1, (int)thread::hardware_concurrency());
+    threads = max(1, min(threads, k));
+    // Each thread owns a strided share of the landmarks and so a disjoint set of columns.
+    auto run = [&](int t) {
+        TRACE_SCOPE("LandmarkSketch::build/bfs");
+        vector<int> queue;
+        vector<int> dist(vertices_, -1);
+        for (int l = t; l < k; l += threads) {
+            queue.assign(1, landmarks_[l]);
+            dist[landmarks_[l]] = 0;
+            for (size_t head = 0; head < queue.size(); head++) {
+                int u = queue[head];
+                if (dist[u] < kUnknownLandmarkDist) dist_[(size_t)u * stride_ + l] = (uint8_t)dist[u];
+                for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                    int v = csr.targets[e];
+                    if (dist[v] == -1) {
+                        dist[v] = dist[u] + 1;
+                        queue.push_back(v);
+                    }
+                }
+            }
+            for (int u : queue) dist[u] = -1;
+        }
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) pool.emplace_back(run, t);
+    run(0);
+    for (thread& th : pool) th.join();
+}
+
+/**
+ * Returns lower and upper bounds on the distance between two vertices.
+ * @param u The index of the first vertex.
+ * @param v The index of the second vertex.
+ * @return The distance bounds.
+ */
+DistanceBounds LandmarkSketch::bounds(int u, int v) const {
+    DistanceBounds result;
+    if (u == v) {
+        result.upper = 0;
+        return result;
+    }
+    const uint8_t* a = &dist_[(size_t)u * stride_];
+    const uint8_t* b = &dist_[(size_t)v * stride_];
+    int lower = 0;
+    int upper = 2 * kUnknownLandmarkDist;
+#if defined(__SSE2__) || defined(_M_X64)
+    // Differences fit in 8 bits, but sums reach 508, so they are taken in 16-bit lanes to agree with the scalar path.
+    // Lanes where either distance is unknown keep 0 as the difference and 2 * kUnknownLandmarkDist as the sum.
+    __m128i unknown = _mm_set1_epi8((char)kUnknownLandmarkDist);
+    __m128i zero = _mm_setzero_si128();
+    __m128i no_upper = _mm_set1_epi16(2 * kUnknownLandmarkDist);
+    __m128i low = zero;
+    __m128i up = no_upper;
+    for (int i = 0; i < stride_; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i known = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(x, unknown), _mm_cmpeq_epi8(y, unknown)), _mm_set1_epi8(-1));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+        low = _mm_max_epu8(low, _mm_and_si128(diff, known));
+        __m128i sum_lo = _mm_add_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero));
+        __m128i sum_hi = _mm_add_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero));
+        __m128i known_lo = _mm_unpacklo_epi8(known, known);
+        __m128i known_hi = _mm_unpackhi_epi8(known, known);
+        up = _mm_min_epi16(up, _mm_or_si128(_mm_and_si128(known_lo, sum_lo), _mm_andnot_si128(known_lo, no_upper)));
+        up = _mm_min_epi16(up, _mm_or_si128(_mm_and_si128(known_hi, sum_hi), _mm_andnot_si128(known_hi, no_upper)));
+    }
+    alignas(16) uint8_t lows[16];
+    alignas(16) uint16_t ups[8];
+    _mm_store_si128((__m128i*)lows, low);
+    _mm_store_si128((__m128i*)ups, up);
+    for (int i = 0; i < 16; i++) lower = max(lower, (int)lows[i]);
+    for (int i = 0; i < 8; i++) upper = min(upper, (int)ups[i]);
+#else
+    for (int i = 0; i < stride_; i++) {
+        if (a[i] == kUnknownLandmarkDist || b[i] == kUnknownLandmarkDist) continue;
+        lower = max(lower, abs((int)a[i] - (int)b[i]));
+        upper = min(upper, (int)a[i] + (int)b[i]);
+    }
+#endif
+    result.lower = max(lower, 1);
+    result.upper = upper < 2 * kUnknownLandmarkDist ? upper : -1;
+    return result;
+}
+
+/**
+ * Returns the exact distance, using the sketch bounds to limit a bidirectional BFS.
+ * @param csr The graph the sketch was built for.
+ * @param u The index of the first vertex.
+ * @param v The index of the second vertex.
+ * @return The exact hop distance, or -1 if not connected.
+ */
+int LandmarkSketch::exact_distance(const CsrGraph& csr, int u, int v) const {
+    DistanceBounds b = bounds(u, v);
+    if (b.upper == b.lower) return b.upper;
+    int d = bounded_bidirectional_bfs(csr, u, v, b.upper);
+    return d == -1 ? b.upper : d;
+}
+
+/**
+ * Returns the chosen landmarks.
+ * @return The landmark vertices.
+ */
+const vector<int>& LandmarkSketch::get_landmarks() const {
+    return landmarks_;
+}
+
+/**
+ * A view of a graph restricted to the vertices whose mask entry is non-zero.
+ * Masked-out vertices keep their index but have no edges.
+ * Neither the graph nor the mask is copied, both must outlive the view.
+ */
+template <typename Base>
+class VertexMaskView {
+public:
+    /**
+     * Constructor for the VertexMaskView class.
+     *
+     * @param base The underlying graph or view.
+     * @param mask One entry per vertex, non-zero if the vertex is kept.
+     */
+    VertexMaskView(const Base& base, const vector<uint8_t>& mask) : base_(base), mask_(mask) {}
+
+    // View interface, see CsrGraph.
+    int num_vertices() const { return base_.num_vertices(); }
+
+    template <typename F>
+    void for_each_neighbor(int u, F f) const {
+        if (!mask_[u]) return;
+        base_.for_each_neighbor(u, [&](int v, int weight) {
+            if (mask_[v]) f(v, weight);
+        });
+    }
+
+private:
+    const Base& base_; // The underlying graph or view.
+    const vector<uint8_t>& mask_; // The vertex mask.
+};
+
+/**
+ * A view of a graph restricted to the edges accepted by a predicate pred(u, v, weight).
+ */
+template <typename Base, typename Pred>
+class EdgeFilterView {
+public:
+    /**
+     * Constructor for the EdgeFilterView class.
+     *
+     * @param base The underlying graph or view.
+     * @param pred The predicate deciding which edges are kept.
+     */
+    EdgeFilterView(const Base& base, Pred pred) : base_(base), pred_(pred) {}
+
+    // View interface, see CsrGraph.
+    int num_vertices() const { return base_.num_vertices(); }
+
+    template <typename F>
+    void for_each_neighbor(int u, F f) const {
+        base_.for_each_neighbor(u, [&](int v, int weight) {
+            if (pred_(u, v, weight)) f(v, weight);
+        });
+    }
+
+private:
+    const Base& base_; // The underlying graph or view.
+    Pred pred_; // The edge predicate.
+};
+
+/**
+ * A view of the subgraph induced by a sorted list of vertices, renumbered 0 .. size - 1.
+ */
+template <typename Base>
+class InducedSubgraphView {
+public:
+    /**
+     * Constructor for the InducedSubgraphView class.
+     *
+     * @param base The underlying graph or view.
+     * @param vertices The kept vertices of the base graph, sorted in increasing order.
+     */
+    InducedSubgraphView(const Base& base, const vector<int>& vertices) : base_(base), vertices_(vertices) {}
+
+    // View interface, see CsrGraph.
+    int num_vertices() const { return (int)vertices_.size(); }
+
+    /**
+     * Maps a local vertex index to the base graph.
+     *
+     * @param u The local index of the vertex.
+     * @return The index of the vertex in the base graph.
+     */
+    int to_base(int u) const { return vertices_[u]; }
+
+    /**
+     * Maps a base graph vertex to its local index.
+     *
+     * @param v The index of the vertex in the base graph.
+     * @return The local index, or -1 if the vertex is not part of the subgraph.
+     */
+    int to_local(int v) const {
+        vector<int>::const_iterator it = lower_bound(vertices_.begin(), vertices_.end(), v);
+        return it != vertices_.end() && *it == v ? (int)(it - vertices_.begin()) : -1;
+    }
+
+    template <typename F>
+    void for_each_neighbor(int u, F f) const {
+        base_.for_each_neighbor(vertices_[u], [&](int v, int weight) {
+            int local = to_local(v);
+            if (local != -1) f(local, weight);
+        });
+    }
+
+private:
+    const Base& base_; // The underlying graph or view.
+    const vector<int>& vertices_; // The kept vertices, sorted.
+};
+
+/**
+ * Creates a vertex mask view without spelling out the template arguments.
+ * @param base The underlying graph or view.
+ * @param mask One entry per vertex, non-zero if the vertex is kept.
+ * @return The view.
+ */
+template <typename Base>
+VertexMaskView<Base> make_vertex_mask_view(const Base& base, const vector<uint8_t>& mask) {
+    return VertexMaskView<Base>(base, mask);
+}
+
+/**
+ * Creates an edge filter view without spelling out the template arguments.
+ * @param base The underlying graph or view.
+ * @param pred The predicate deciding which edges are kept.
+ * @return The view.
+ */
+template <typename Base, typename Pred>
+EdgeFilterView<Base, Pred> make_edge_filter_view(const Base& base, Pred pred) {
+    return EdgeFilterView<Base, Pred>(base, pred);
+}
+
+/**
+ * Creates an induced subgraph view without spelling out the template arguments.
+ * @param base The underlying graph or view.
+ * @param vertices The kept vertices, sorted in increasing order.
+ * @return The view.
+ */
+template <typename Base>
+InducedSubgraphView<Base> make_induced_subgraph_view(const Base& base, const vector<int>& vertices) {
+    return InducedSubgraphView<Base>(base, vertices);
+}
+
+/**
+ * Computes BFS hop distances on any graph or view that provides num_vertices() and for_each_neighbor().
+ *
+ * @param g The graph or view to search.
+ * @param source The index of the source vertex.
+ * @return The distance to every vertex, -1 for unreachable vertices.
+ */
+template <typename View>
+vector<int> bfs_distances(const View& g, int source) {
+    vector<int> dist(g.num_vertices(), -1);
+    vector<int> queue(1, source);
+    dist[source] = 0;
+    // The queue holds whole levels back to back, so each level is one traced span.
+    for (size_t begin = 0; begin < queue.size();) {
+        TRACE_SCOPE("bfs_distances/level");
+        size_t end = queue.size();
+        for (size_t head = begin; head < end; head++) {
+            int u = queue[head];
+            g.for_each_neighbor(u, [&](int v, int) {
+                if (dist[v] == -1) {
+                    dist[v] = dist[u] + 1;
+                    queue.push_back(v);
+                }
+            });
+        }
+        begin = end;
+    }
+    return dist;
+}
+
+/**
+ * Computes the BFS shortest path between two vertices on any graph or view.
+ *
+ * @param g The graph or view to search.
+ * @param source The index of the source vertex.
+ * @param target The index of the target vertex.
+ * @return The vertices on the shortest path from source to target, or an empty vector if there is no path.
+ */
+template <typename View>
+vector<int> bfs_shortest_path(const View& g, int source, int target) {
+    vector<int> parent(g.num_vertices(), -1);
+    vector<int> queue(1, source);
+    parent[source] = source;
+    for (size_t head = 0; head < queue.size() && parent[target] == -1; head++) {
+        int u = queue[head];
+        g.for_each_neighbor(u, [&](int v, int) {
+            if (parent[v] == -1) {
+                parent[v] = u;
+                queue.push_back(v);
+            }
+        });
+    }
+    vector<int> path;
+    if (parent[target] == -1) return path;
+    for (int u = target; u != source; u = parent[u]) path.push_back(u);
+    path.push_back(source);
+    reverse(path.begin(), path.end());
+    return path;
+}
+
+/**
+ * Computes the BFS hop distance between two vertices without recording parents or a path.
+ * Visited vertices are kept in a bitset and the search runs level by level over two frontier arrays,
+ * so the per-vertex state is one bit.
+ *
+ * @param g The graph or view to search.
+ * @param source The index of the source vertex.
+ * @param target The index of the target vertex.
+ * @return The number of edges on a shortest path, -1 if the target is unreachable.
+ */
+template <typename View>
+int bfs_distance(const View& g, int source, int target) {
+    if (source == target) return 0;
+    vector<uint64_t> visited((g.num_vertices() + 63) / 64, 0);
+    vector<int> frontier(1, source);
+    vector<int> next;
+    visited[source >> 6] |= 1ULL << (source & 63);
+    for (int depth = 1; !frontier.empty(); depth++) {
+        next.clear();
+        bool found = false;
+        for (int u : frontier) {
+            g.for_each_neighbor(u, [&](int v, int) {
+                uint64_t bit = 1ULL << (v & 63);
+                if (visited[v >> 6] & bit) return;
+                visited[v >> 6] |= bit;
+                if (v == target) found = true;
+                next.push_back(v);
+            });
+            if (found) return depth;
+        }
+        frontier.swap(next);
+    }
+    return -1;
+}
+
+/**
+ * Computes BFS hop distances into a narrow level type, such as uint8_t or uint16_t, to cut
+ * memory traffic and output size when the graph diameter is known to be small.
+ * The largest value of Level marks unreachable vertices.
+ *
+ * @param g The graph or view to search.
+ * @param source The index of the source vertex.
+ * @param levels Receives the distance to every vertex.
+ * @return True on success, false if some vertex is deeper than Level can hold.
+ * Vertices past the limit are then left marked unreachable, and the caller should retry with a wider type.
+ */
+template <typename Level, typename View>
+bool bfs_levels(const View& g, int source, vector<Level>& levels) {
+    const Level unreached = numeric_limits<Level>::max();
+    levels.assign(g.num_vertices(), unreached);
+    vector<int> queue(1, source);
+    levels[source] = 0;
+    for (size_t head = 0; head < queue.size(); head++) {
+        int u = queue[head];
+        Level next = (Level)(levels[u] + 1);
+        if (next == unreached) {
+            bool overflow = false;
+            g.for_each_neighbor(u, [&](int v, int) { if (levels[v] == unreached) overflow = true; });
+            if (overflow) return false;
+            continue;
+        }
+        g.for_each_neighbor(u, [&](int v, int) {
+            if (levels[v] == unreached) {
+                levels[v] = next;
+                queue.push_back(v);
+            }
+        });
+    }
+    return true;
+}
+
+/**
+ * Materializes a graph or view into a new CSR using several threads.
+ * Degrees and edges are produced per block of vertices, so every thread writes a disjoint range.
+ *
+ * @param g The graph or view to extract.
+ * @param directed Whether the result should be marked as directed.
+ * @param threads Number of threads, 0 means hardware concurrency.
+ * @return The CSR holding exactly the edges visible through the view.
+ */
+template <typename View>
+CsrGraph extract_csr(const View& g, bool directed, int threads = 0) {
+    TRACE_SCOPE("extract_csr");
+    CsrGraph csr;
+    csr.vertices = g.num_vertices();
+    csr.directed = directed;
+    csr.offsets.assign(csr.vertices + 1, 0);
+    if (threads <= 0) threads = max(1, (int)thread::hardware_concurrency());
+    int block = max(1, (csr.vertices + threads - 1) / threads);
+
+    auto run_blocks = [&](function<void(int, int)> work) {
+        auto traced = [&](int begin, int end) {
+            TRACE_SCOPE("extract_csr/block");
+            work(begin, end);
+        };
+        vector<thread> pool;
+        for (int begin = block; begin < csr.vertices; begin += block) {
+            pool.emplace_back(traced, begin, min(begin + block, csr.vertices));
+        }
+        traced(0, min(block, csr.vertices));
+        for (thread& th : pool) th.join();
+    };
+
+    run_blocks([&](int begin, int end) {
+        for (int u = begin; u < end; u++) {
+            int count = 0;
+            g.for_each_neighbor(u, [&](int, int) { count++; });
+            csr.offsets[u + 1] = count;
+        }
+    });
+    for (int u = 0; u < csr.vertices; u++) csr.offsets[u + 1] += csr.offsets[u];
+    csr.targets.resize(csr.offsets[csr.vertices]);
+    csr.weights.resize(csr.offsets[csr.vertices]);
+    run_blocks([&](int begin, int end) {
+        for (int u = begin; u < end; u++) {
+            int pos = csr.offsets[u];
+            g.for_each_neighbor(u, [&](int v, int weight) {
+                csr.targets[pos] = v;
+                csr.weights[pos++] = weight;
+            });
+        }
+    });
+    return csr;
+}
+
+/**
+ * An append-only bit stream, most significant bit first, with the instantaneous codes used by graph compression.
+ */
+class BitWriter {
+public:
+    /**
+     * Appends the lowest n bits of a value.
+     *
+     * @param value The bits to append.
+     * @param n The number of bits, at most 64.
+     */
+    void write_bits(uint64_t value, int n) {
+        for (int i = n - 1; i >= 0; i--) {
+            if ((bits_ & 63) == 0) words_.push_back(0);
+            if ((value >> i) & 1) words_.back() |= 1ULL << (63 - (bits_ & 63));
+            bits_++;
+        }
+    }
+
+    /**
+     * Appends x >= 0 in Elias gamma code.
+     *
+     * @param x The value to append.
+     */
+    void write_gamma(uint64_t x) {
+        uint64_t y = x + 1;
+        int nb = 63 - count_leading_zeros(y);
+        write_bits(0, nb);
+        write_bits(y, nb + 1);
+    }
+
+    /**
+     * Appends x >= 0 in zeta_k code: the unary bucket h = floor(log2(x + 1) / k) followed by (h + 1) * k bits.
+     * This is the fixed-width variant, without the minimal binary refinement.
+     *
+     * @param x The value to append.
+     * @param k The shrinking factor.
+     */
+    void write_zeta(uint64_t x, int k) {
+        uint64_t y = x + 1;
+        int h = (63 - count_leading_zeros(y)) / k;
+        write_bits(0, h);
+        write_bits(1, 1);
+        write_bits(y, (h + 1) * k);
+    }
+
+    /**
+     * Returns the number of bits written so far.
+     *
+     * @return The length of the stream in bits.
+     */
+    uint64_t size() const { return bits_; }
+
+    /**
+     * Returns the underlying words.
+     *
+     * @return The stream contents, padded with zero bits to a whole word.
+     */
+    const vector<uint64_t>& words() const { return words_; }
+
+    /**
+     * Counts the leading zero bits of a non-zero value.
+     *
+     * @param y The value, must not be zero.
+     * @return The number of leading zero bits.
+     */
+    static int count_leading_zeros(uint64_t y) {
+        int n = 0;
+        for (uint64_t bit = 1ULL << 63; (y & bit) == 0; bit >>= 1) n++;
+        return n;
+    }
+
+private:
+    vector<uint64_t> words_; // The stream contents.
+    uint64_t bits_ = 0; // The number of bits written.
+};
+
+/**
+ * Reads a bit stream produced by BitWriter.
+ */
+class BitReader {
+public:
+    /**
+     * Constructor for the BitReader class.
+     *
+     * @param words The stream contents. Must outlive the reader.
+     * @param position The bit offset to start reading from.
+     */
+    BitReader(const vector<uint64_t>& words, uint64_t position) : words_(words), pos_(position) {}
+
+    /**
+     * Reads n bits as an unsigned value.
+     *
+     * @param n The number of bits, at most 64.
+     * @return The value read.
+     */
+    uint64_t read_bits(int n) {
+        uint64_t value = 0;
+        while (n > 0) {
+            int offset = (int)(pos_ & 63);
+            int take = min(n, 64 - offset);
+            uint64_t word = words_[pos_ >> 6] << offset;
+            value = (take == 64 ? 0 : value << take) | (word >> (64 - take));
+            pos_ += take;
+            n -= take;
+        }
+        return value;
+    }
+
+    /**
+     * Reads a unary prefix, the number of zero bits before the next one bit, and consumes the one bit.
+     *
+     * @return The number of zero bits.
+     */
+    int read_unary() {
+        int n = 0;
+        for (;;) {
+            uint64_t word = words_[pos_ >> 6] << (pos_ & 63);
+            if (word != 0) {
+                int z = BitWriter::count_leading_zeros(word);
+                pos_ += z + 1;
+                return n + z;
+            }
+            int rest = 64 - (int)(pos_ & 63);
+            n += rest;
+            pos_ += rest;
+        }
+    }
+
+    /**
+     * Reads a value written with write_gamma.
+     *
+     * @return The value read.
+     */
+    uint64_t read_gamma() {
+        int nb = read_unary();
+        return ((1ULL << nb) | read_bits(nb)) - 1;
+    }
+
+    /**
+     * Reads a value written with write_zeta.
+     *
+     * @param k The shrinking factor used when writing.
+     * @return The value read.
+     */
+    uint64_t read_zeta(int k) {
+        int h = read_unary();
+        return read_bits((h + 1) * k) - 1;
+    }
+
+private:
+    const vector<uint64_t>& words_; // The stream contents.
+    uint64_t pos_; // The current bit offset.
+};
+
+/**
+ * Maps a signed value to an unsigned one so that small magnitudes get short codes.
+ * @param x The signed value.
+ * @return 2x for x >= 0, -2x - 1 otherwise.
+ */
+static uint64_t zigzag_encode(int64_t x) {
+    return x >= 0 ? (uint64_t)x * 2 : (uint64_t)(-x) * 2 - 1;
+}
+
+/**
+ * Inverts zigzag_encode.
+ * @param x The unsigned value.
+ * @return The signed value.
+ */
+static int64_t zigzag_decode(uint64_t x) {
+    return (x & 1) ? -(int64_t)((x + 1) / 2) : (int64_t)(x / 2);
+}
+
+/**
+ * Parameters of the WebGraph-style compression.
+ */
+struct CompressionOptions {
+    int window = 7; // How many previous lists may be used as a reference, 0 disables referencing.
+    int max_ref_count = 3; // The maximum length of a reference chain, bounds random access cost.
+    int min_interval = 3; // The minimum length of a run of consecutive neighbours stored as an interval.
+    int zeta_k = 3; // The zeta code parameter for residual gaps.
+    bool reorder = true; // Whether to relabel vertices in BFS order for better locality.
+};
+
+/**
+ * Reusable decode buffers of one thread, handed out as a stack. Every level of a reference chain and
+ * every nested for_each_neighbor call takes its own buffers, so once they have grown decoding allocates
+ * nothing. A deque keeps the buffers in place when it grows.
+ */
+struct CompressedDecodeScratch {
+    deque<vector<int>> buffers; // Every buffer ever handed out.
+    size_t top = 0; // The number of buffers in use.
+
+    /**
+     * Takes an empty buffer from the top of the stack.
+     *
+     * @return The buffer, valid until top is reset below it.
+     */
+    vector<int>& acquire() {
+        if (top == buffers.size()) buffers.emplace_back();
+        vector<int>& buffer = buffers[top++];
+        buffer.clear();
+        return buffer;
+    }
+};
+
+/**
+ * An adjacency structure compressed in the style of the WebGraph framework.
+ * Every sorted neighbour list is stored as an optional reference to one of the previous lists
+ * with copy blocks saying which of its neighbours are reused, then intervals of consecutive
+ * neighbours, then gap-coded residuals. Vertices are optionally relabelled in BFS order so that
+ * similar lists sit close to each other. Edge weights are not stored.
+ */
+class CompressedGraph {
+public:
+    /**
+     * Compresses a graph.
+     *
+     * @param csr The graph to compress.
+     * @param options The compression parameters.
+     */
+    void build(const CsrGraph& csr, const CompressionOptions& options = CompressionOptions());
+
+    /**
+     * Returns the number of vertices. Part of the view interface, see CsrGraph.
+     *
+     * @return The number of vertices.
+     */
+    int num_vertices() const { return vertices_; }
+
+    /**
+     * Calls f(v, 1) for every neighbour v of u by decoding its list. Part of the view interface, see CsrGraph.
+     *
+     * @param u The index of the vertex.
+     * @param f The function to call.
+     */
+    template <typename F>
+    void for_each_neighbor(int u, F f) const {
+        CompressedDecodeScratch& scratch = decode_scratch();
+        size_t mark = scratch.top;
+        vector<int>& list = scratch.acquire();
+        decode(rank_[u], list, nullptr);
+        for (int v : list) f(order_[v], 1);
+        scratch.top = mark;
+    }
+
+    /**
+     * Decodes every list once in storage order, keeping the reference window in memory instead of
+     * decoding references again. Calls f(u, neighbours) with original vertex indices.
+     *
+     * @param f The function to call for each vertex.
+     */
+    template <typename F>
+    void scan(F f) const {
+        vector<vector<int>> window(window_ + 1);
+        vector<int> mapped;
+        for (int x = 0; x < vertices_; x++) {
+            vector<int>& list = window[x % (window_ + 1)];
+            decode(x, list, &window);
+            mapped.resize(list.size());
+            for (size_t i = 0; i < list.size(); i++) mapped[i] = order_[list[i]];
+            f(order_[x], mapped);
+        }
+    }
+
+    /**
+     * Returns the size of the compressed lists.
+     *
+     * @return The number of bits used by the neighbour lists, excluding offsets and the vertex order.
+     */
+    uint64_t get_bits() const { return stream_.size(); }
+
+private:
+    int vertices_ = 0; // The number of vertices.
+    int window_ = 0; // The reference window.
+    int min_interval_ = 0; // The minimum interval length.
+    int zeta_k_ = 0; // The zeta code parameter.
+    vector<int> order_; // order_[x] is the original index of stored vertex x.
+    vector<int> rank_; // rank_[u] is the stored index of original vertex u.
+    vector<uint64_t> offsets_; // Bit offset of every stored list.
+    BitWriter stream_; // The compressed lists.
+
+    /**
+     * Encodes one sorted list against an optional reference list.
+     *
+     * @param out The stream to append to.
+     * @param x The stored index of the vertex.
+     * @param list The sorted neighbours of x.
+     * @param r The distance to the reference vertex, 0 for none.
+     * @param ref The neighbours of vertex x - r, ignored if r is 0.
+     */
+    void encode(BitWriter& out, int x, const vector<int>& list, int r, const vector<int>& ref) const;
+
+    /**
+     * Decodes the list of a stored vertex.
+     *
+     * @param x The stored index of the vertex.
+     * @param out Receives the sorted neighbours, as stored indices.
+     * @param window Recently decoded lists indexed by x % (window + 1), or nullptr to decode references recursively.
+     */
+    void decode(int x, vector<int>& out, const vector<vector<int>>* window) const;
+
+    /**
+     * Returns the decode buffers of the calling thread.
+     *
+     * @return The buffers.
+     */
+    static CompressedDecodeScratch& decode_scratch() {
+        thread_local CompressedDecodeScratch scratch;
+        return scratch;
+    }
+};
+
+/**
+ * Compresses a graph.
+ * @param csr The graph to compress.
+ * @param options The compression parameters.
+ */
+void CompressedGraph::build(const CsrGraph& csr, const CompressionOptions& options) {
+    TRACE_SCOPE("CompressedGraph::build");
+    vertices_ = csr.vertices;
+    window_ = max(0, options.window);
+    min_interval_ = max(2, options.min_interval);
+    zeta_k_ = max(1, options.zeta_k);
+
+    // BFS order over all components puts neighbours, and so similar lists, next to each other.
+    order_.clear();
+    rank_.assign(vertices_, -1);
+    for (int s = 0; s < vertices_; s++) {
+        if (!options.reorder) {
+            rank_[s] = s;
+            order_.push_back(s);
+            continue;
+        }
+        if (rank_[s] != -1) continue;
+        rank_[s] = (int)order_.size();
+        order_.push_back(s);
+        for (size_t head = rank_[s]; head < order_.size(); head++) {
+            int u = order_[head];
+            for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                int v = csr.targets[e];
+                if (rank_[v] == -1) {
+                    rank_[v] = (int)order_.size();
+                    order_.push_back(v);
+                }
+            }
+        }
+    }
+
+    stream_ = BitWriter();
+    offsets_.assign(vertices_, 0);
+    vector<vector<int>> lists(window_ + 1);
+    vector<int> chain(vertices_, 0); // Length of the reference chain ending at each vertex.
+    for (int x = 0; x < vertices_; x++) {
+        vector<int>& list = lists[x % (window_ + 1)];
+        list.clear();
+        int u = order_[x];
+        for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) list.push_back(rank_[csr.targets[e]]);
+        sort(list.begin(), list.end());
+        list.erase(unique(list.begin(), list.end()), list.end());
+
+        // Try every reference in the window and keep the cheapest encoding.
+        int best_r = 0;
+        BitWriter trial;
+        encode(trial, x, list, 0, list);
+        uint64_t best_bits = trial.size();
+        for (int r = 1; r <= window_ && r <= x; r++) {
+            if (chain[x - r] >= options.max_ref_count) continue;
+            BitWriter candidate;
+            encode(candidate, x, list, r, lists[(x - r) % (window_ + 1)]);
+            if (candidate.size() < best_bits) {
+                best_bits = candidate.size();
+                best_r = r;
+            }
+        }
+        chain[x] = best_r > 0 ? chain[x - best_r] + 1 : 0;
+        offsets_[x] = stream_.size();
+        encode(stream_, x, list, best_r, lists[(x - best_r) % (window_ + 1)]);
+    }
+}
+
+/**
+ * Encodes one sorted list against an optional reference list.
+ * @param out The stream to append to.
+ * @param x The stored index of the vertex.
+ * @param list The sorted neighbours of x.
+ * @param r The distance to the reference vertex, 0 for none.
+ * @param ref The neighbours of vertex x - r.
+ */
+void CompressedGraph::encode(BitWriter& out, int x, const vector<int>& list, int r, const vector<int>& ref) const {
+    out.write_gamma(list.size());
+    if (list.empty()) return;
+    if (window_ > 0) out.write_gamma(r);
+
+    vector<int> extra;
+    if (r > 0) {
+        // Copy blocks alternate copy/skip over the reference list, starting with a copy block.
+        vector<int> blocks;
+        bool copying = true;
+        int run = 0;
+        size_t j = 0;
+        for (int v : ref) {
+            while (j < list.size() && list[j] < v) extra.push_back(list[j++]);
+            bool present = j < list.size() && list[j] == v;
+            if (present) j++;
+            if (present != copying) {
+                blocks.push_back(run);
+                copying = !copying;
+                run = 0;
+            }
+            run++;
+        }
+        while (j < list.size()) extra.push_back(list[j++]);
+        // The last block is implied by the length of the reference list.
+        out.write_gamma(blocks.size());
+        for (size_t b = 0; b < blocks.size(); b++) out.write_gamma(b == 0 ? blocks[b] : blocks[b] - 1);
+    }
+    else {
+        extra = list;
+    }
+
+    // Intervals of at least min_interval_ consecutive neighbours.
+    vector<pair<int, int>> intervals; // (left, length)
+    vector<int> residuals;
+    for (size_t i = 0; i < extra.size();) {
+        size_t j = i + 1;
+        while (j < extra.size() && extra[j] == extra[j - 1] + 1) j++;
+        if ((int)(j - i) >= min_interval_) intervals.push_back(make_pair(extra[i], (int)(j - i)));
+        else residuals.insert(residuals.end(), extra.begin() + i, extra.begin() + j);
+        i = j;
+    }
+    out.write_gamma(intervals.size());
+    for (size_t i = 0; i < intervals.size(); i++) {
+        if (i == 0) out.write_gamma(zigzag_encode((int64_t)intervals[i].first - x));
+        else out.write_gamma(intervals[i].first - (intervals[i - 1].first + intervals[i - 1].second) - 1);
+        out.write_gamma(intervals[i].second - min_interval_);
+    }
+
+    for (size_t i = 0; i < residuals.size(); i++) {
+        if (i == 0) out.write_zeta(zigzag_encode((int64_t)residuals[i] - x), zeta_k_);
+        else out.write_zeta(residuals[i] - residuals[i - 1] - 1, zeta_k_);
+    }
+}
+
+/**
+ * Decodes the list of a stored vertex.
+ * @param x The stored index of the vertex.
+ * @param out Receives the sorted neighbours, as stored indices.
+ * @param window Recently decoded lists, or nullptr to decode references recursively.
+ */
+void CompressedGraph::decode(int x, vector<int>& out, const vector<vector<int>>* window) const {
+    BitReader in(stream_.words(), offsets_[x]);
+    int degree = (int)in.read_gamma();
+    out.clear();
+    if (degree == 0) return;
+    int r = window_ > 0 ? (int)in.read_gamma() : 0;
+
+    CompressedDecodeScratch& scratch = decode_scratch();
+    size_t mark = scratch.top;
+    vector<int>& copied = scratch.acquire();
+    if (r > 0) {
+        const vector<int>* ref;
+        if (window != nullptr) {
+            ref = &(*window)[(x - r) % (window_ + 1)];
+        } else {
+            vector<int>& decoded = scratch.acquire();
+            decode(x - r, decoded, nullptr);
+            ref = &decoded;
+        }
+        int num_blocks = (int)in.read_gamma();
+        size_t pos = 0;
+        bool copying = true;
+        for (int b = 0; b < num_blocks; b++) {
+            size_t len = (size_t)in.read_gamma() + (b == 0 ? 0 : 1);
+            if (copying) copied.insert(copied.end(), ref->begin() + pos, ref->begin() + pos + len);
+            pos += len;
+            copying = !copying;
+        }
+        if (copying) copied.insert(copied.end(), ref->begin() + pos, ref->end());
+    }
+
+    vector<int>& extra = scratch.acquire();
+    int num_intervals = (int)in.read_gamma();
+    int prev_end = 0;
+    for (int i = 0; i < num_intervals; i++) {
+        int left = i == 0 ? (int)(x + zigzag_decode(in.read_gamma())) : prev_end + 1 + (int)in.read_gamma();
+        int len = (int)in.read_gamma() + min_interval_;
+        for (int v = left; v < left + len; v++) extra.push_back(v);
+        prev_end = left + len;
+    }
+
+    int num_residuals = degree - (int)copied.size() - (int)extra.size();
+    size_t interval_end = extra.size();
+    int prev = 0;
+    for (int i = 0; i < num_residuals; i++) {
+        prev = i == 0 ? (int)(x + zigzag_decode(in.read_zeta(zeta_k_))) : prev + 1 + (int)in.read_zeta(zeta_k_);
+        extra.push_back(prev);
+    }
+    inplace_merge(extra.begin(), extra.begin() + interval_end, extra.end());
+
+    out.resize(copied.size() + extra.size());
+    merge(copied.begin(), copied.end(), extra.begin(), extra.end(), out.begin());
+    scratch.top = mark;
+}
+
+/**
+ * Counts the one bits of a word.
+ * @param x The word.
+ * @return The number of set bits.
+ */
+static inline int popcount64(uint64_t x) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+/**
+ * A fixed-width packed integer array.
+ */
+class PackedArray {
+public:
+    /**
+     * Allocates the array.
+     *
+     * @param size The number of entries.
+     * @param width The number of bits per entry, at most 64.
+     */
+    void init(size_t size, int width) {
+        width_ = width;
+        words_.assign((size * width + 63) / 64 + 1, 0);
+    }
+
+    /**
+     * Stores an entry.
+     *
+     * @param i The index of the entry.
+     * @param value The value, must fit in width bits.
+     */
+    void set(size_t i, uint64_t value) {
+        if (width_ == 0) return;
+        uint64_t pos = (uint64_t)i * width_;
+        int offset = (int)(pos & 63);
+        words_[pos >> 6] |= value << offset;
+        if (offset + width_ > 64) words_[(pos >> 6) + 1] |= value >> (64 - offset);
+    }
+
+    /**
+     * Loads an entry.
+     *
+     * @param i The index of the entry.
+     * @return The stored value.
+     */
+    uint64_t get(size_t i) const {
+        if (width_ == 0) return 0;
+        uint64_t pos = (uint64_t)i * width_;
+        int offset = (int)(pos & 63);
+        uint64_t value = words_[pos >> 6] >> offset;
+        if (offset + width_ > 64) value |= words_[(pos >> 6) + 1] << (64 - offset);
+        return width_ == 64 ? value : value & ((1ULL << width_) - 1);
+    }
+
+    /**
+     * Returns the memory used by the array.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const { return words_.size() * sizeof(uint64_t); }
+
+private:
+    int width_ = 0; // Bits per entry.
+    vector<uint64_t> words_; // The packed entries, with one spare word for straddling reads.
+};
+
+/**
+ * Returns the number of bits needed to store values up to max_value.
+ * @param max_value The largest value.
+ * @return The bit width, at least 1.
+ */
+static int bit_width(uint64_t max_value) {
+    int width = 1;
+    while (width < 64 && (max_value >> width) != 0) width++;
+    return width;
+}
+
+/**
+ * A bitvector with constant-time rank and sampled select on the one bits.
+ */
+class RankSelectBitvector {
+public:
+    /**
+     * Allocates a bitvector of zeros.
+     *
+     * @param size The number of bits.
+     */
+    void init(size_t size) {
+        size_ = size;
+        words_.assign((size + 63) / 64, 0);
+    }
+
+    /**
+     * Sets a bit to one. Must be called before build_index.
+     *
+     * @param i The index of the bit.
+     */
+    void set(size_t i) { words_[i >> 6] |= 1ULL << (i & 63); }
+
+    /**
+     * Returns a bit.
+     *
+     * @param i The index of the bit.
+     * @return True if the bit is one.
+     */
+    bool get(size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
+
+    /**
+     * Builds the rank and select directories.
+     */
+    void build_index() {
+        ranks_.assign(words_.size() + 1, 0);
+        samples_.clear();
+        uint64_t ones = 0;
+        for (size_t w = 0; w < words_.size(); w++) {
+            ranks_[w] = ones;
+            uint64_t word = words_[w];
+            while (word != 0) {
+                if (ones % kSelectSample == 0) samples_.push_back(w);
+                word &= word - 1;
+                ones++;
+            }
+        }
+        ranks_[words_.size()] = ones;
+    }
+
+    /**
+     * Counts the one bits before a position.
+     *
+     * @param i The position, at most the size of the bitvector.
+     * @return The number of ones in [0, i).
+     */
+    uint64_t rank1(size_t i) const {
+        uint64_t r = ranks_[i >> 6];
+        if (i & 63) r += popcount64(words_[i >> 6] & ((1ULL << (i & 63)) - 1));
+        return r;
+    }
+
+    /**
+     * Finds the position of a one bit.
+     *
+     * @param k The zero-based rank of the one bit.
+     * @return The position of the k-th one bit.
+     */
+    size_t select1(uint64_t k) const {
+        size_t w = samples_[k / kSelectSample];
+        while (ranks_[w + 1] <= k) w++;
+        uint64_t word = words_[w];
+        for (uint64_t skip = k - ranks_[w]; skip > 0; skip--) word &= word - 1;
+        size_t bit = 0;
+        while (((word >> bit) & 1) == 0) bit++;
+        return w * 64 + bit;
+    }
+
+    /**
+     * Returns the memory used by the bitvector and its directories.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const { return (words_.size() + ranks_.size() + samples_.size()) * sizeof(uint64_t); }
+
+private:
+    static const int kSelectSample = 256; // Every kSelectSample-th one bit has its word recorded.
+    size_t size_ = 0; // The number of bits.
+    vector<uint64_t> words_; // The bits.
+    vector<uint64_t> ranks_; // Number of ones before each word.
+    vector<uint64_t> samples_; // Word index of every kSelectSample-th one bit.
+};
+
+/**
+ * A monotone integer sequence in Elias-Fano encoding.
+ * Each value keeps its low bits in a packed array and its high part in unary inside a bitvector,
+ * using about 2 + log2(universe / size) bits per value with constant-time access through select.
+ */
+class EliasFanoSequence {
+public:
+    /**
+     * Encodes a non-decreasing sequence.
+     *
+     * @param values The sequence to encode.
+     */
+    void build(const vector<uint64_t>& values) {
+        size_ = values.size();
+        uint64_t universe = values.empty() ? 1 : values.back() + 1;
+        low_bits_ = 0;
+        while (size_ > 0 && (universe / size_) >> (low_bits_ + 1) != 0) low_bits_++;
+        low_.init(size_, low_bits_);
+        high_.init(size_ + (universe >> low_bits_) + 1);
+        for (size_t i = 0; i < size_; i++) {
+            if (low_bits_ > 0) low_.set(i, values[i] & ((1ULL << low_bits_) - 1));
+            high_.set((values[i] >> low_bits_) + i);
+        }
+        high_.build_index();
+    }
+
+    /**
+     * Returns a value of the sequence.
+     *
+     * @param i The index of the value.
+     * @return The i-th value.
+     */
+    uint64_t get(size_t i) const {
+        return ((uint64_t)(high_.select1(i) - i) << low_bits_) | low_.get(i);
+    }
+
+    /**
+     * Returns the memory used by the sequence.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const { return low_.bytes() + high_.bytes(); }
+
+private:
+    size_t size_ = 0; // The number of values.
+    int low_bits_ = 0; // Bits per value kept in the low array.
+    PackedArray low_; // The low bits of every value.
+    RankSelectBitvector high_; // The high parts, value i sets bit (high + i).
+};
+
+/**
+ * A succinct graph: CSR offsets in Elias-Fano encoding and bit-packed neighbours and weights.
+ * Degree and neighbour access are constant time, and the structure implements the view interface
+ * so the traversal templates run on it directly.
+ */
+class SuccinctGraph {
+public:
+    /**
+     * Builds the succinct representation of a graph.
+     *
+     * @param csr The graph to encode.
+     */
+    void build(const CsrGraph& csr) {
+        vertices_ = csr.vertices;
+        vector<uint64_t> offsets(csr.offsets.begin(), csr.offsets.end());
+        offsets_.build(offsets);
+        size_t edges = csr.targets.size();
+        // Weights are stored relative to the smallest one, so negative weights pack as well.
+        int max_weight = 0;
+        weight_base_ = 0;
+        if (edges > 0) {
+            weight_base_ = *min_element(csr.weights.begin(), csr.weights.end());
+            max_weight = *max_element(csr.weights.begin(), csr.weights.end());
+        }
+        targets_.init(edges, bit_width(max(vertices_ - 1, 0)));
+        weights_.init(edges, bit_width((uint64_t)((long long)max_weight - weight_base_)));
+        for (size_t i = 0; i < edges; i++) {
+            targets_.set(i, csr.targets[i]);
+            weights_.set(i, (uint64_t)((long long)csr.weights[i] - weight_base_));
+        }
+    }
+
+    // View interface, see CsrGraph.
+    int num_vertices() const { return vertices_; }
+
+    template <typename F>
+    void for_each_neighbor(int u, F f) const {
+        size_t end = (size_t)offsets_.get(u + 1);
+        for (size_t i = (size_t)offsets_.get(u); i < end; i++) f((int)targets_.get(i), (int)((long long)weights_.get(i) + weight_base_));
+    }
+
+    /**
+     * Returns the number of neighbours of a vertex.
+     *
+     * @param u The index of the vertex.
+     * @return The out-degree of u.
+     */
+    int degree(int u) const { return (int)(offsets_.get(u + 1) - offsets_.get(u)); }
+
+    /**
+     * Returns one neighbour of a vertex.
+     *
+     * @param u The index of the vertex.
+     * @param i The position in the neighbour list, less than degree(u).
+     * @return The i-th neighbour of u.
+     */
+    int neighbor(int u, int i) const { return (int)targets_.get((size_t)offsets_.get(u) + i); }
+
+    /**
+     * Returns the memory used by the graph.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const { return offsets_.bytes() + targets_.bytes() + weights_.bytes(); }
+
+private:
+    int vertices_ = 0; // The number of vertices.
+    EliasFanoSequence offsets_; // The CSR row offsets.
+    PackedArray targets_; // The neighbours, ceil(log2(V)) bits each.
+    PackedArray weights_; // The edge weights minus weight_base_, packed to the widest difference.
+    int weight_base_ = 0; // The smallest edge weight.
+};
+
+/**
+ * A k^2-tree: a compressed adjacency matrix.
+ * The matrix is split into k x k blocks recursively, every level stores one bit per block telling
+ * whether it contains any edge, and only non-empty blocks are split further. The bits of all levels
+ * but the last (T) and of the last level (L) are kept in one rank-enabled bitvector in level order,
+ * so the children of the block at bit p start at rank1(p + 1) * k^2.
+ */
+class K2Tree {
+public:
+    /**
+     * Builds the tree from the adjacency of a graph.
+     *
+     * @param csr The graph whose adjacency matrix is encoded. Undirected graphs are stored symmetrically.
+     * @param k The branching factor per dimension. Default is 2.
+     */
+    void build(const CsrGraph& csr, int k = 2);
+
+    /**
+     * Checks whether the matrix entry (u, v) is set, in O(log_k V).
+     *
+     * @param u The row vertex.
+     * @param v The column vertex.
+     * @return True if there is an edge from u to v.
+     */
+    bool has_edge(int u, int v) const;
+
+    /**
+     * Returns the out-neighbours of a vertex, the set entries of row u.
+     *
+     * @param u The row vertex.
+     * @return The neighbours in increasing order.
+     */
+    vector<int> row(int u) const;
+
+    /**
+     * Returns the in-neighbours of a vertex, the set entries of column v, without a transposed copy.
+     *
+     * @param v The column vertex.
+     * @return The reverse neighbours in increasing order.
+     */
+    vector<int> column(int v) const;
+
+    /**
+     * Returns every edge (u, v) with row_begin <= u < row_end and col_begin <= v < col_end.
+     *
+     * @param row_begin The first row.
+     * @param row_end One past the last row.
+     * @param col_begin The first column.
+     * @param col_end One past the last column.
+     * @return The edges in the range.
+     */
+    vector<pair<int, int>> range(int row_begin, int row_end, int col_begin, int col_end) const;
+
+    // View interface, see CsrGraph. Weights are not stored, every edge reports weight 1.
+    int num_vertices() const { return vertices_; }
+
+    template <typename F>
+    void for_each_neighbor(int u, F f) const {
+        for (int v : row(u)) f(v, 1);
+    }
+
+    /**
+     * Returns the memory used by the tree.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const { return bits_.bytes(); }
+
+private:
+    int vertices_ = 0; // The number of vertices.
+    int k_ = 2; // The branching factor per dimension.
+    int height_ = 0; // The number of levels.
+    int side_ = 1; // The padded matrix side, k^height.
+    size_t internal_bits_ = 0; // The number of bits in T, the levels above the leaves.
+    RankSelectBitvector bits_; // T followed by L.
+
+    /**
+     * Returns the position of the first child of the block at a bit position, or of the root's children for -1.
+     *
+     * @param p The bit position of the block in T, or -1 for the root.
+     * @return The bit position of its first child.
+     */
+    size_t children(long long p) const { return p < 0 ? 0 : (size_t)bits_.rank1((size_t)p + 1) * k_ * k_; }
+
+    /**
+     * Reports the set entries inside a block that intersect a query rectangle.
+     *
+     * @param p The bit position of the block, or -1 for the root.
+     * @param size The side of the block.
+     * @param row0 The first row of the block.
+     * @param col0 The first column of the block.
+     * @param r1 The first queried row.
+     * @param r2 One past the last queried row.
+     * @param c1 The first queried column.
+     * @param c2 One past the last queried column.
+     * @param out Receives the edges found.
+     */
+    void collect(long long p, int size, int row0, int col0, int r1, int r2, int c1, int c2, vector<pair<int, int>>& out) const;
+};
+
+/**
+ * Builds the tree from the adjacency of a graph.
+ * @param csr The graph whose adjacency matrix is encoded.
+ * @param k The branching factor per dimension.
+ */
+void K2Tree::build(const CsrGraph& csr, int k) {
+    TRACE_SCOPE("K2Tree::build");
+    vertices_ = csr.vertices;
+    k_ = max(2, k);
+    height_ = 1;
+    side_ = k_;
+    while (side_ < vertices_) {
+        side_ *= k_;
+        height_++;
+    }
+
+    // Depth-first splitting appends the blocks of each level left to right, which is level order.
+    vector<vector<bool>> levels(height_);
+    vector<pair<int, int>> edges;
+    for (int u = 0; u < csr.vertices; u++) {
+        for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) edges.push_back(make_pair(u, csr.targets[e]));
+    }
+    function<void(int, int, int, int, vector<pair<int, int>>&)> split =
+        [&](int level, int size, int row0, int col0, vector<pair<int, int>>& block) {
+        int sub = size / k_;
+        vector<vector<pair<int, int>>> parts(k_ * k_);
+        for (const pair<int, int>& e : block) {
+            parts[(e.first - row0) / sub * k_ + (e.second - col0) / sub].push_back(e);
+        }
+        block.clear();
+        block.shrink_to_fit();
+        for (int i = 0; i < k_ * k_; i++) levels[level].push_back(!parts[i].empty());
+        if (level + 1 == height_) return;
+        for (int i = 0; i < k_ * k_; i++) {
+            if (!parts[i].empty()) split(level + 1, sub, row0 + i / k_ * sub, col0 + i % k_ * sub, parts[i]);
+        }
+    };
+    split(0, side_, 0, 0, edges);
+
+    size_t total = 0;
+    internal_bits_ = 0;
+    for (int level = 0; level < height_; level++) {
+        total += levels[level].size();
+        if (level + 1 < height_) internal_bits_ += levels[level].size();
+    }
+    bits_.init(total);
+    size_t pos = 0;
+    for (int level = 0; level < height_; level++) {
+        for (bool b : levels[level]) {
+            if (b) bits_.set(pos);
+            pos++;
+        }
+    }
+    bits_.build_index();
+}
+
+/**
+ * Checks whether the matrix entry (u, v) is set.
+ * @param u The row vertex.
+ * @param v The column vertex.
+ * @return True if there is an edge from u to v.
+ */
+bool K2Tree::has_edge(int u, int v) const {
+    long long p = -1;
+    int size = side_;
+    for (int level = 0; level < height_; level++) {
+        size /= k_;
+        p = (long long)children(p) + (u / size % k_) * k_ + (v / size % k_);
+        if (!bits_.get((size_t)p)) return false;
+    }
+    return true;
+}
+
+/**
+ * Returns the out-neighbours of a vertex.
+ * @param u The row vertex.
+ * @return The neighbours in increasing order.
+ */
+vector<int> K2Tree::row(int u) const {
+    vector<pair<int, int>> found;
+    collect(-1, side_, 0, 0, u, u + 1, 0, vertices_, found);
+    vector<int> result;
+    for (const pair<int, int>& e : found) result.push_back(e.second);
+    return result;
+}
+
+/**
+ * Returns the in-neighbours of a vertex.
+ * @param v The column vertex.
+ * @return The reverse neighbours in increasing order.
+ */
+vector<int> K2Tree::column(int v) const {
+    vector<pair<int, int>> found;
+    collect(-1, side_, 0, 0, 0, vertices_, v, v + 1, found);
+    vector<int> result;
+    for (const pair<int, int>& e : found) result.push_back(e.first);
+    sort(result.begin(), result.end());
+    return result;
+}
+
+/**
+ * Returns every edge inside a rectangle of the matrix.
+ * @param row_begin The first row.
+ * @param row_end One past the last row.
+ * @param col_begin The first column.
+ * @param col_end One past the last column.
+ * @return The edges in the range.
+ */
+vector<pair<int, int>> K2Tree::range(int row_begin, int row_end, int col_begin, int col_end) const {
+    vector<pair<int, int>> found;
+    collect(-1, side_, 0, 0, row_begin, row_end, col_begin, col_end, found);
+    return found;
+}
+
+/**
+ * Reports the set entries inside a block that intersect a query rectangle.
+ * @param p The bit position of the block, or -1 for the root.
+ * @param size The side of the block.
+ * @param row0 The first row of the block.
+ * @param col0 The first column of the block.
+ * @param r1 The first queried row.
+ * @param r2 One past the last queried row.
+ * @param c1 The first queried column.
+ * @param c2 One past the last queried column.
+ * @param out Receives the edges found.
+ */
+void K2Tree::collect(long long p, int size, int row0, int col0, int r1, int r2, int c1, int c2, vector<pair<int, int>>& out) const {
+    if (p >= (long long)internal_bits_) {
+        out.push_back(make_pair(row0, col0));
+        return;
+    }
+    int sub = size / k_;
+    size_t first = children(p);
+    for (int i = max(0, (r1 - row0) / sub); i < k_ && row0 + i * sub < r2; i++) {
+        for (int j = max(0, (c1 - col0) / sub); j < k_ && col0 + j * sub < c2; j++) {
+            size_t q = first + i * k_ + j;
+            if (bits_.get(q)) collect((long long)q, sub, row0 + i * sub, col0 + j * sub, r1, r2, c1, c2, out);
+        }
+    }
+}
+
+/**
+ * An edge-existence index that does not need a dense adjacency matrix.
+ * Low-degree vertices are answered by a branchless binary search over their sorted neighbours
+ * in O(log d), hubs by a per-vertex open-addressing hash set in expected O(1).
+ */
+class EdgeIndex {
+public:
+    /**
+     * Builds the index.
+     *
+     * @param csr The graph to index.
+     * @param hub_degree Vertices with at least this many neighbours get a hash set. Default is 64.
+     */
+    void build(const CsrGraph& csr, int hub_degree = 64);
+
+    /**
+     * Checks whether there is an edge from u to v.
+     *
+     * @param u The starting vertex of the edge.
+     * @param v The ending vertex of the edge.
+     * @return True if the edge exists.
+     */
+    bool has_edge(int u, int v) const;
+
+    /**
+     * Returns the memory used by the index.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const;
+
+private:
+    vector<int> offsets_; // CSR offsets into sorted_.
+    vector<int> sorted_; // Neighbours of every vertex, sorted.
+    vector<int> hub_slot_; // Offset of the hash table of each vertex in table_, -1 if it is not a hub.
+    vector<int> hub_mask_; // Table size minus one for every hub.
+    vector<int> table_; // Open-addressing tables of all hubs, empty slots hold -1.
+
+    /**
+     * Hashes a vertex index for the hub tables.
+     *
+     * @param v The vertex index.
+     * @return A well-mixed hash of v.
+     */
+    static uint32_t hash(int v) {
+        uint32_t x = (uint32_t)v;
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        return x ^ (x >> 16);
+    }
+};
+
+/**
+ * Builds the index.
+ * @param csr The graph to index.
+ * @param hub_degree Vertices with at least this many neighbours get a hash set.
+ */
+void EdgeIndex::build(const CsrGraph& csr, int hub_degree) {
+    TRACE_SCOPE("EdgeIndex::build");
+    offsets_ = csr.offsets;
+    sorted_ = csr.targets;
+    hub_slot_.assign(csr.vertices, -1);
+    hub_mask_.assign(csr.vertices, 0);
+    table_.clear();
+    for (int u = 0; u < csr.vertices; u++) {
+        sort(sorted_.begin() + offsets_[u], sorted_.begin() + offsets_[u + 1]);
+        int degree = offsets_[u + 1] - offsets_[u];
+        if (degree < hub_degree) continue;
+        // Power of two capacity with load factor at most one half.
+        int capacity = 1;
+        while (capacity < 2 * degree) capacity *= 2;
+        hub_slot_[u] = (int)table_.size();
+        hub_mask_[u] = capacity - 1;
+        table_.resize(table_.size() + capacity, -1);
+        int* slots = &table_[hub_slot_[u]];
+        for (int i = offsets_[u]; i < offsets_[u + 1]; i++) {
+            int v = sorted_[i];
+            uint32_t h = hash(v) & hub_mask_[u];
+            while (slots[h] != -1 && slots[h] != v) h = (h + 1) & hub_mask_[u];
+            slots[h] = v;
+        }
+    }
+}
+
+/**
+ * Checks whether there is an edge from u to v.
+ * @param u The starting vertex of the edge.
+ * @param v The ending vertex of the edge.
+ * @return True if the edge exists.
+ */
+bool EdgeIndex::has_edge(int u, int v) const {
+    if (hub_slot_[u] != -1) {
+        const int* slots = &table_[hub_slot_[u]];
+        uint32_t mask = hub_mask_[u];
+        for (uint32_t h = hash(v) & mask;; h = (h + 1) & mask) {
+            if (slots[h] == v) return true;
+            if (slots[h] == -1) return false;
+        }
+    }
+    int n = offsets_[u + 1] - offsets_[u];
+    if (n == 0) return false;
+    // Branchless lower bound: the conditional move keeps the loop free of unpredictable jumps.
+    const int* base = sorted_.data() + offsets_[u];
+    while (n > 1) {
+        int half = n / 2;
+        base = base[half] <= v ? base + half : base;
+        n -= half;
+    }
+    return *base == v;
+}
+
+/**
+ * Returns the memory used by the index.
+ * @return The size in bytes.
+ */
+size_t EdgeIndex::bytes() const {
+    return (offsets_.size() + sorted_.size() + hub_slot_.size() + hub_mask_.size() + table_.size()) * sizeof(int);
+}
+
+/**
+ * Half-storage representation of an undirected graph.
+ * The weight matrix is kept as a packed lower triangle of V * (V + 1) / 2 entries instead of V * V,
+ * and the CSR keeps every edge and its weight once, in the row of its smaller endpoint. The rows
+ * of the larger endpoints keep a back reference to the neighbour and the position of the edge in
+ * the owning row, so its weight is read in constant time. The lists take 4 ints per edge like a
+ * CSR storing both directions; the saving is in the matrix, and every weight has a single copy.
+ */
+class SymmetricGraph {
+public:
+    /**
+     * Builds the symmetric representation from an undirected graph.
+     * The adjacency list of an undirected Graph holds every edge in both directions, so only the
+     * direction leaving the smaller endpoint is read.
+     *
+     * @param g The graph to convert.
+     * @param with_matrix Whether to also build the packed triangular matrix. Default is true.
+     * @return True on success, false if g is directed, which leaves the representation empty.
+     */
+    bool build(Graph& g, bool with_matrix = true);
+
+    /**
+     * Returns the weight of the edge between two vertices, in either order.
+     * Uses the triangular matrix if present and the CSR otherwise.
+     *
+     * @param u The first vertex.
+     * @param v The second vertex.
+     * @return The weight of the edge, or 0 if there is no edge.
+     */
+    int weight(int u, int v) const;
+
+    /**
+     * Checks whether two vertices are adjacent.
+     *
+     * @param u The first vertex.
+     * @param v The second vertex.
+     * @return True if the edge exists.
+     */
+    bool has_edge(int u, int v) const { return weight(u, v) != 0; }
+
+    /**
+     * Calls f(u, v, weight) once for every undirected edge, with u <= v.
+     *
+     * @param f The function to call.
+     */
+    template <typename F>
+    void for_each_edge(F f) const {
+        for (int u = 0; u < vertices_; u++) {
+            for (int i = upper_offsets_[u]; i < upper_offsets_[u + 1]; i++) f(u, upper_targets_[i], upper_weights_[i]);
+        }
+    }
+
+    // View interface, see CsrGraph.
+    int num_vertices() const { return vertices_; }
+
+    template <typename F>
+    void for_each_neighbor(int u, F f) const {
+        for (int i = lower_offsets_[u]; i < lower_offsets_[u + 1]; i++) f(lower_targets_[i], upper_weights_[lower_edges_[i]]);
+        for (int i = upper_offsets_[u]; i < upper_offsets_[u + 1]; i++) f(upper_targets_[i], upper_weights_[i]);
+    }
+
+    /**
+     * Prints the adjacency matrix of the graph in the same format as Graph::print_adj_matrix.
+     */
+    void print_adj_matrix() const;
+
+    /**
+     * Returns the memory used by the representation.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const;
+
+private:
+    int vertices_ = 0; // The number of vertices.
+    vector<int> tri_; // Packed lower triangle, entry (u, v) with u >= v at u * (u + 1) / 2 + v.
+    vector<int> upper_offsets_; // CSR offsets of the rows owning each edge.
+    vector<int> upper_targets_; // Neighbours v >= u of every vertex u, sorted.
+    vector<int> upper_weights_; // Weights of the owned edges.
+    vector<int> lower_offsets_; // CSR offsets of the back references.
+    vector<int> lower_targets_; // Neighbours v < u of every vertex u, sorted.
+    vector<int> lower_edges_; // Position of each back-referenced edge in the owning row.
+
+    /**
+     * Looks up the weight of an edge in the row that owns it.
+     *
+     * @param u The smaller endpoint.
+     * @param v The larger endpoint.
+     * @return The weight of the edge, or 0 if there is no edge.
+     */
+    int upper_weight(int u, int v) const {
+        vector<int>::const_iterator first = upper_targets_.begin() + upper_offsets_[u];
+        vector<int>::const_iterator last = upper_targets_.begin() + upper_offsets_[u + 1];
+        vector<int>::const_iterator it = lower_bound(first, last, v);
+        return it != last && *it == v ? upper_weights_[it - upper_targets_.begin()] : 0;
+    }
+};
+
+/**
+ * Builds the symmetric representation from an undirected graph.
+ * @param g The graph to convert.
+ * @param with_matrix Whether to also build the packed triangular matrix.
+ * @return True on success, false if g is directed.
+ */
+bool SymmetricGraph::build(Graph& g, bool with_matrix) {
+    TRACE_SCOPE("SymmetricGraph::build");
+    if (g.is_directed()) {
+        *this = SymmetricGraph();
+        return false;
+    }
+    vertices_ = g.get_num_vertices();
+    vector<vector<pair<int, int>>> adj_list = g.get_adj_list();
+
+    // Keep every edge once, from the row of its smaller endpoint. The list is sorted by (min, max).
+    vector<pair<pair<int, int>, int>> unique_edges;
+    for (int u = 0; u < vertices_; u++) {
+        for (const pair<int, int>& e : adj_list[u]) {
+            if (u <= e.first) unique_edges.push_back(make_pair(make_pair(u, e.first), e.second));
+        }
+    }
+    sort(unique_edges.begin(), unique_edges.end());
+
+    upper_offsets_.assign(vertices_ + 1, 0);
+    lower_offsets_.assign(vertices_ + 1, 0);
+    for (const pair<pair<int, int>, int>& e : unique_edges) {
+        upper_offsets_[e.first.first + 1]++;
+        if (e.first.first != e.first.second) lower_offsets_[e.first.second + 1]++;
+    }
+    for (int u = 0; u < vertices_; u++) {
+        upper_offsets_[u + 1] += upper_offsets_[u];
+        lower_offsets_[u + 1] += lower_offsets_[u];
+    }
+    upper_targets_.resize(upper_offsets_[vertices_]);
+    upper_weights_.resize(upper_offsets_[vertices_]);
+    lower_targets_.resize(lower_offsets_[vertices_]);
+    lower_edges_.resize(lower_offsets_[vertices_]);
+    vector<int> lower_cursor(lower_offsets_.begin(), lower_offsets_.end() - 1);
+    // Edges are sorted by (min, max), so both sides come out sorted.
+    for (size_t i = 0; i < unique_edges.size(); i++) {
+        int u = unique_edges[i].first.first;
+        int v = unique_edges[i].first.second;
+        upper_targets_[i] = v;
+        upper_weights_[i] = unique_edges[i].second;
+        if (u != v) {
+            lower_targets_[lower_cursor[v]] = u;
+            lower_edges_[lower_cursor[v]++] = (int)i;
+        }
+    }
+
+    tri_.clear();
+    if (with_matrix) {
+        tri_.assign((size_t)vertices_ * (vertices_ + 1) / 2, 0);
+        for (const pair<pair<int, int>, int>& e : unique_edges) {
+            tri_[(size_t)e.first.second * (e.first.second + 1) / 2 + e.first.first] = e.second;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the weight of the edge between two vertices, in either order.
+ * @param u The first vertex.
+ * @param v The second vertex.
+ * @return The weight of the edge, or 0 if there is no edge.
+ */
+int SymmetricGraph::weight(int u, int v) const {
+    if (u < v) swap(u, v);
+    if (!tri_.empty()) return tri_[(size_t)u * (u + 1) / 2 + v];
+    return upper_weight(v, u);
+}
+
+/**
+ * Prints the adjacency matrix of the graph.
+ */
+void SymmetricGraph::print_adj_matrix() const {
+    cout << "  ";
+    for (int i = 0; i < vertices_; i++) { cout << "V" << i << " "; }
+    cout << endl;
+    for (int i = 0; i < vertices_; i++) {
+        cout << "V" << i << " ";
+        for (int j = 0; j < vertices_; j++) {
+            if (weight(i, j) > 0) cout << 1 << "  ";
+            else cout << 0 << "  ";
+        }
+        cout << endl;
+    }
+    cout << endl;
+}
+
+/**
+ * Returns the memory used by the representation.
+ * @return The size in bytes.
+ */
+size_t SymmetricGraph::bytes() const {
+    return (tri_.size() + upper_offsets_.size() + upper_targets_.size() + upper_weights_.size()
+        + lower_offsets_.size() + lower_targets_.size() + lower_edges_.size()) * sizeof(int);
+}
+
+const int kTiledInfinity = INT_MAX / 2; // Distance of unreachable entries, small enough that two can be added.
+
+/**
+ * A file-backed dense int matrix stored in blocked row-major order: the matrix is cut into
+ * tile x tile blocks, the blocks are laid out row by row and every block is contiguous.
+ * The file is memory-mapped, so matrices larger than RAM are paged in and out by the OS,
+ * and algorithms that work one tile at a time read the file sequentially.
+ */
+class TiledMatrix {
+public:
+    TiledMatrix() = default;
+    TiledMatrix(const TiledMatrix&) = delete;
+    TiledMatrix& operator=(const TiledMatrix&) = delete;
+
+    /**
+     * Unmaps the file.
+     */
+    ~TiledMatrix() { close(); }
+
+    /**
+     * Creates a new matrix file, or truncates an existing one, filled with a value.
+     *
+     * @param path The path of the backing file.
+     * @param size The number of rows and columns.
+     * @param tile The side of one tile. Default is 64, a 16 KB block.
+     * @param fill The initial value of every entry. Default is kTiledInfinity.
+     * @return True on success, false if the file could not be created or mapped.
+     */
+    bool create(const string& path, int size, int tile = 64, int fill = kTiledInfinity);
+
+    /**
+     * Opens a matrix file written earlier.
+     *
+     * @param path The path of the backing file.
+     * @return True on success, false if the file could not be opened or is not a matrix file.
+     */
+    bool open(const string& path);
+
+    /**
+     * Flushes and unmaps the file.
+     */
+    void close();
+
+    /**
+     * Returns a matrix entry.
+     *
+     * @param i The row.
+     * @param j The column.
+     * @return A reference to the entry inside the mapping.
+     */
+    int& at(int i, int j) { return tile_data(i / tile_, j / tile_)[(i % tile_) * tile_ + j % tile_]; }
+
+    /**
+     * Returns the first entry of a tile. The tile holds tile * tile entries in row-major order.
+     *
+     * @param ti The tile row.
+     * @param tj The tile column.
+     * @return A pointer to the tile.
+     */
+    int* tile_data(int ti, int tj) { return data_ + ((size_t)ti * tiles_ + tj) * tile_ * tile_; }
+
+    int get_size() const { return size_; } // The number of rows and columns.
+    int get_tile() const { return tile_; } // The side of one tile.
+    int get_tiles() const { return tiles_; } // The number of tiles per row and column.
+
+private:
+    static const size_t kHeaderSize = 64; // Bytes before the data: magic, size and tile.
+    int size_ = 0; // The number of rows and columns.
+    int tile_ = 0; // The side of one tile.
+    int tiles_ = 0; // Tiles per row, size rounded up to whole tiles.
+    size_t bytes_ = 0; // The length of the mapping.
+    char* base_ = nullptr; // The start of the mapping.
+    int* data_ = nullptr; // The first tile.
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE; // The backing file.
+    HANDLE mapping_ = nullptr; // The file mapping object.
+#else
+    int fd_ = -1; // The backing file.
+#endif
+
+    /**
+     * Maps the backing file, creating it with the given length if requested.
+     *
+     * @param path The path of the backing file.
+     * @param bytes The length to create, or 0 to map an existing file.
+     * @return True on success.
+     */
+    bool map(const string& path, size_t bytes);
+};
+
+/**
+ * Maps the backing file.
+ * @param path The path of the backing file.
+ * @param bytes The length to create, or 0 to map an existing file.
+ * @return True on success.
+ */
+bool TiledMatrix::map(const string& path, size_t bytes) {
+#if defined(_WIN32)
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, bytes > 0 ? CREATE_ALWAYS : OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER length;
+    if (bytes > 0) length.QuadPart = (LONGLONG)bytes;
+    else if (!GetFileSizeEx(file_, &length)) return false;
+    bytes_ = (size_t)length.QuadPart;
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, length.HighPart, length.LowPart, nullptr);
+    if (mapping_ == nullptr) return false;
+    base_ = (char*)MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, bytes_);
+    return base_ != nullptr;
+#else
+    fd_ = ::open(path.c_str(), bytes > 0 ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+    if (fd_ < 0) return false;
+    if (bytes > 0 && ftruncate(fd_, (off_t)bytes) != 0) return false;
+    struct stat st;
+    if (fstat(fd_, &st) != 0) return false;
+    bytes_ = (size_t)st.st_size;
+    void* p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) return false;
+    base_ = (char*)p;
+    madvise(base_, bytes_, MADV_SEQUENTIAL);
+    return true;
+#endif
+}
+
+/**
+ * Creates a new matrix file filled with a value.
+ * @param path The path of the backing file.
+ * @param size The number of rows and columns.
+ * @param tile The side of one tile.
+ * @param fill The initial value of every entry.
+ * @return True on success.
+ */
+bool TiledMatrix::create(const string& path, int size, int tile, int fill) {
+    close();
+    size_ = size;
+    tile_ = max(1, tile);
+    tiles_ = (size + tile_ - 1) / tile_;
+    size_t entries = (size_t)tiles_ * tiles_ * tile_ * tile_;
+    if (!map(path, kHeaderSize + entries * sizeof(int))) {
+        close();
+        return false;
+    }
+    memcpy(base_, "TILEDMX1", 8);
+    memcpy(base_ + 8, &size_, sizeof(int));
+    memcpy(base_ + 12, &tile_, sizeof(int));
+    data_ = (int*)(base_ + kHeaderSize);
+    for (int ti = 0; ti < tiles_; ti++) {
+        for (int tj = 0; tj < tiles_; tj++) fill_n(tile_data(ti, tj), (size_t)tile_ * tile_, fill);
+    }
+    return true;
+}
+
+/**
+ * Opens a matrix file written earlier.
+ * @param path The path of the backing file.
+ * @return True on success.
+ */
+bool TiledMatrix::open(const string& path) {
+    close();
+    if (!map(path, 0) || bytes_ < kHeaderSize || memcmp(base_, "TILEDMX1", 8) != 0) {
+        close();
+        return false;
+    }
+    memcpy(&size_, base_ + 8, sizeof(int));
+    memcpy(&tile_, base_ + 12, sizeof(int));
+    tiles_ = tile_ > 0 ? (size_ + tile_ - 1) / tile_ : 0;
+    if (tile_ <= 0 || bytes_ < kHeaderSize + (size_t)tiles_ * tiles_ * tile_ * tile_ * sizeof(int)) {
+        close();
+        return false;
+    }
+    data_ = (int*)(base_ + kHeaderSize);
+    return true;
+}
+
+/**
+ * Flushes and unmaps the file.
+ */
+void TiledMatrix::close() {
+#if defined(_WIN32)
+    if (base_ != nullptr) {
+        FlushViewOfFile(base_, 0);
+        UnmapViewOfFile(base_);
+    }
+    if (mapping_ != nullptr) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (base_ != nullptr) {
+        msync(base_, bytes_, MS_SYNC);
+        munmap(base_, bytes_);
+    }
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    base_ = nullptr;
+    data_ = nullptr;
+    bytes_ = 0;
+}
+
+/**
+ * Fills a tiled matrix with the edge weights of a graph, 0 on the diagonal and kTiledInfinity elsewhere.
+ *
+ * @param g The graph to copy.
+ * @param m The matrix, already created with g's number of vertices.
+ */
+void load_weight_matrix(Graph& g, TiledMatrix& m) {
+    TRACE_SCOPE("load_weight_matrix");
+    vector<vector<pair<int, int>>> adj_list = g.get_adj_list();
+    for (int u = 0; u < m.get_size(); u++) {
+        m.at(u, u) = 0;
+        for (const pair<int, int>& e : adj_list[u]) {
+            m.at(u, e.first) = min(m.at(u, e.first), e.second);
+        }
+    }
+}
+
+/**
+ * Relaxes tile c through tiles a and b: c[i][j] = min(c[i][j], a[i][k] + b[k][j]) with k outermost,
+ * which stays correct when c aliases a or b.
+ * @param c The tile to update.
+ * @param a The tile supplying the (i, k) entries.
+ * @param b The tile supplying the (k, j) entries.
+ * @param t The side of the tiles.
+ */
+static void min_plus_tile(int* c, const int* a, const int* b, int t) {
+    for (int k = 0; k < t; k++) {
+        for (int i = 0; i < t; i++) {
+            int aik = a[i * t + k];
+            if (aik >= kTiledInfinity) continue;
+            int* crow = c + i * t;
+            const int* brow = b + k * t;
+            for (int j = 0; j < t; j++) crow[j] = min(crow[j], aik + brow[j]);
+        }
+    }
+}
+
+/**
+ * Runs blocked Floyd-Warshall in place on a tiled weight matrix.
+ * Each round handles one diagonal tile, then its tile row and column, then every other tile,
+ * so all work is done on whole tiles and the mapping is swept tile by tile.
+ *
+ * @param m The weight matrix, overwritten with all-pairs shortest distances.
+ */
+void floyd_warshall_tiled(TiledMatrix& m) {
+    TRACE_SCOPE("floyd_warshall_tiled");
+    int tiles = m.get_tiles();
+    int t = m.get_tile();
+    for (int kb = 0; kb < tiles; kb++) {
+        int* diagonal = m.tile_data(kb, kb);
+        min_plus_tile(diagonal, diagonal, diagonal, t);
+        for (int j = 0; j < tiles; j++) {
+            if (j != kb) min_plus_tile(m.tile_data(kb, j), diagonal, m.tile_data(kb, j), t);
+        }
+        for (int i = 0; i < tiles; i++) {
+            if (i != kb) min_plus_tile(m.tile_data(i, kb), m.tile_data(i, kb), diagonal, t);
+        }
+        for (int i = 0; i < tiles; i++) {
+            if (i == kb) continue;
+            const int* column = m.tile_data(i, kb);
+            for (int j = 0; j < tiles; j++) {
+                if (j != kb) min_plus_tile(m.tile_data(i, j), column, m.tile_data(kb, j), t);
+            }
+        }
+    }
+}
+
+/**
+ * Computes the transitive closure in place: after the call every entry is 1 if the column vertex
+ * is reachable from the row vertex and 0 otherwise.
+ *
+ * @param m The weight matrix as filled by load_weight_matrix.
+ */
+void transitive_closure_tiled(TiledMatrix& m) {
+    TRACE_SCOPE("transitive_closure_tiled");
+    floyd_warshall_tiled(m);
+    int t = m.get_tile();
+    for (int ti = 0; ti < m.get_tiles(); ti++) {
+        for (int tj = 0; tj < m.get_tiles(); tj++) {
+            int* tile = m.tile_data(ti, tj);
+            for (int e = 0; e < t * t; e++) tile[e] = tile[e] < kTiledInfinity ? 1 : 0;
+        }
+    }
+}
+
+/**
+ * Prints a tiled matrix in the same format as Graph::print_adj_matrix, with INF for unreachable entries.
+ *
+ * @param m The matrix to print.
+ */
+void print_tiled_matrix(TiledMatrix& m) {
+    TRACE_SCOPE("print_tiled_matrix");
+    cout << "  ";
+    for (int i = 0; i < m.get_size(); i++) { cout << "V" << i << " "; }
+    cout << endl;
+    for (int i = 0; i < m.get_size(); i++) {
+        cout << "V" << i << " ";
+        for (int j = 0; j < m.get_size(); j++) {
+            if (m.at(i, j) >= kTiledInfinity) cout << "INF ";
+            else cout << m.at(i, j) << "  ";
+        }
+        cout << endl;
+    }
+    cout << endl;
+}
+
+/**
+ * A source of edges read once, front to back, without building a graph.
+ */
+class EdgeStream {
+public:
+    virtual ~EdgeStream() {}
+
+    /**
+     * Reads the next edge.
+     *
+     * @param u Receives the starting vertex.
+     * @param v Receives the ending vertex.
+     * @param weight Receives the weight, 1 if the source has none.
+     * @return True if an edge was read, false at the end of the stream.
+     */
+    virtual bool next(int& u, int& v, int& weight) = 0;
+};
+
+/**
+ * Streams "u v [weight]" lines from a file or pipe. Lines starting with '#' or '%' are comments.
+ * The input is read in large blocks and parsed by hand, which keeps up with the disk.
+ */
+class TextEdgeStream : public EdgeStream {
+public:
+    /**
+     * Constructor for the TextEdgeStream class.
+     *
+     * @param in The stream to read, for example an ifstream or cin. Must outlive the edge stream.
+     */
+    explicit TextEdgeStream(istream& in) : in_(in), buffer_(1 << 20), pos_(0), end_(0) {}
+
+    bool next(int& u, int& v, int& weight) override {
+        for (;;) {
+            int c = peek();
+            while (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                pos_++;
+                c = peek();
+            }
+            if (c == -1) return false;
+            if (c == '#' || c == '%') {
+                while (c != -1 && c != '\n') {
+                    pos_++;
+                    c = peek();
+                }
+                continue;
+            }
+            long long values[3] = { 0, 0, 1 };
+            int count = 0;
+            // Read up to three integers from the current line.
+            while (count < 3) {
+                while (c == ' ' || c == '\t' || c == ',') {
+                    pos_++;
+                    c = peek();
+                }
+                if (c == -1 || c == '\n' || c == '\r') break;
+                bool negative = c == '-';
+                if (negative) {
+                    pos_++;
+                    c = peek();
+                }
+                if (c < '0' || c > '9') break;
+                long long x = 0;
+                while (c >= '0' && c <= '9') {
+                    x = x * 10 + (c - '0');
+                    pos_++;
+                    c = peek();
+                }
+                values[count++] = negative ? -x : x;
+            }
+            while (c != -1 && c != '\n') {
+                pos_++;
+                c = peek();
+            }
+            if (count < 2) continue;
+            u = (int)values[0];
+            v = (int)values[1];
+            weight = (int)values[2];
+            return true;
+        }
+    }
+
+private:
+    istream& in_; // The input.
+    vector<char> buffer_; // The current block of input.
+    size_t pos_; // The next unread byte in the buffer.
+    size_t end_; // The number of valid bytes in the buffer.
+
+    /**
+     * Returns the next byte without consuming it, refilling the buffer as needed.
+     *
+     * @return The byte, or -1 at the end of the input.
+     */
+    int peek() {
+        if (pos_ == end_) {
+            in_.read(buffer_.data(), buffer_.size());
+            end_ = (size_t)in_.gcount();
+            pos_ = 0;
+            if (end_ == 0) return -1;
+        }
+        return (unsigned char)buffer_[pos_];
+    }
+};
+
+/**
+ * Streams uniformly random edges from a seeded generator, without ever storing them.
+ */
+class RandomEdgeStream : public EdgeStream {
+public:
+    /**
+     * Constructor for the RandomEdgeStream class.
+     *
+     * @param vertices The number of vertices.
+     * @param edges The number of edges to produce.
+     * @param seed The random seed.
+     */
+    RandomEdgeStream(int vertices, long long edges, unsigned seed) : vertices_(vertices), remaining_(edges), rng_(seed) {}
+
+    bool next(int& u, int& v, int& weight) override {
+        if (remaining_ <= 0) return false;
+        remaining_--;
+        u = (int)(rng_() % vertices_);
+        v = (int)(rng_() % vertices_);
+        weight = (int)(rng_() % 100 + 1);
+        return true;
+    }
+
+private:
+    int vertices_; // The number of vertices.
+    long long remaining_; // Edges left to produce.
+    mt19937 rng_; // The generator.
+};
+
+/**
+ * Everything computed by one pass over an edge stream, using memory proportional to the vertices.
+ */
+struct StreamSummary {
+    int vertices = 0; // One more than the largest vertex seen, or the hint if larger.
+    long long edges = 0; // The number of edges read.
+    int components = 0; // The number of connected components, isolated vertices included.
+    vector<int> component; // The component representative of every vertex.
+    vector<pair<int, int>> forest; // The edges of a spanning forest.
+    bool bipartite = true; // Whether the graph is bipartite, i.e. has no odd cycle.
+    vector<long long> degree_histogram; // degree_histogram[d] is the number of vertices with degree d.
+};
+
+/**
+ * Consumes an edge stream once and computes connected components, a spanning forest,
+ * bipartiteness and the degree histogram, treating every edge as undirected.
+ * A union-find with parity bits keeps, for each vertex, whether it sits on the same side
+ * of the bipartition as its root, so an edge inside a component closes an odd cycle
+ * exactly when both endpoints have the same parity.
+ *
+ * @param stream The edges to consume.
+ * @param vertices_hint The expected number of vertices, arrays grow if larger ids appear.
+ * @return The summary of the stream.
+ */
+StreamSummary summarize_edge_stream(EdgeStream& stream, int vertices_hint = 0) {
+    TRACE_SCOPE("summarize_edge_stream");
+    StreamSummary summary;
+    vector<int> parent;
+    vector<uint8_t> parity; // Parity of the path from a vertex to its parent.
+    vector<int> size;
+    vector<int> degree;
+    auto grow = [&](int n) {
+        if (n <= (int)parent.size()) return;
+        int old = (int)parent.size();
+        int capacity = max(n, old * 2);
+        parent.resize(capacity);
+        for (int i = old; i < capacity; i++) parent[i] = i;
+        parity.resize(capacity, 0);
+        size.resize(capacity, 1);
+        degree.resize(capacity, 0);
+    };
+    // Finds the root of x with path halving, returning the parity of x relative to the root.
+    auto find = [&](int x, int& p) {
+        p = 0;
+        while (parent[x] != x) {
+            int up = parent[x];
+            if (parent[up] != up) {
+                parity[x] ^= parity[up];
+                parent[x] = parent[up];
+            }
+            p ^= parity[x];
+            x = parent[x];
+        }
+        return x;
+    };
+
+    grow(vertices_hint);
+    summary.vertices = vertices_hint;
+    int u, v, weight;
+    while (stream.next(u, v, weight)) {
+        if (u < 0 || v < 0) continue;
+        grow(max(u, v) + 1);
+        summary.vertices = max(summary.vertices, max(u, v) + 1);
+        summary.edges++;
+        degree[u]++;
+        degree[v]++;
+        int pu, pv;
+        int ru = find(u, pu);
+        int rv = find(v, pv);
+        if (ru == rv) {
+            if (pu == pv) summary.bipartite = false;
+            continue;
+        }
+        if (size[ru] < size[rv]) swap(ru, rv);
+        parent[rv] = ru;
+        parity[rv] = (uint8_t)(pu ^ pv ^ 1);
+        size[ru] += size[rv];
+        summary.forest.push_back(make_pair(u, v));
+    }
+
+    summary.component.resize(summary.vertices);
+    for (int x = 0; x < summary.vertices; x++) {
+        int p;
+        summary.component[x] = find(x, p);
+        if (summary.component[x] == x) summary.components++;
+        int d = degree[x];
+        if (d >= (int)summary.degree_histogram.size()) summary.degree_histogram.resize(d + 1, 0);
+        summary.degree_histogram[d]++;
+    }
+    return summary;
+}
+
+/**
+ * One edge of a streaming partition.
+ */
+struct StreamEdge {
+    int src; // The starting vertex.
+    int dst; // The ending vertex.
+    int weight; // The edge weight.
+};
+
+/**
+ * Edges split into partitions by the vertex range of their source, as used by the edge-centric engine.
+ * Partitions live in memory or, after spill(), in one file each that is only ever read front to back.
+ */
+class EdgePartitions {
+public:
+    /**
+     * Builds the partitions from a graph, every stored CSR entry becomes one edge.
+     *
+     * @param csr The graph to partition.
+     * @param partitions The number of partitions. Default is 4.
+     */
+    void build(const CsrGraph& csr, int partitions = 4);
+
+    /**
+     * Moves every partition into its own file and frees the memory.
+     *
+     * @param prefix The path prefix, partition p is written to prefix + "." + p.
+     * @return True on success, false if a file could not be written.
+     */
+    bool spill(const string& prefix);
+
+    /**
+     * Streams the edges of one partition sequentially.
+     *
+     * @param p The partition.
+     * @param f The function to call with every StreamEdge.
+     */
+    template <typename F>
+    void for_each_edge(int p, F f) const {
+        if (paths_.empty()) {
+            for (const StreamEdge& e : edges_[p]) f(e);
+            return;
+        }
+        ifstream in(paths_[p], ios::binary);
+        vector<StreamEdge> block(1 << 16);
+        while (in.read((char*)block.data(), block.size() * sizeof(StreamEdge)) || in.gcount() > 0) {
+            size_t count = (size_t)in.gcount() / sizeof(StreamEdge);
+            for (size_t i = 0; i < count; i++) f(block[i]);
+        }
+    }
+
+    /**
+     * Returns the partition holding a vertex.
+     *
+     * @param v The vertex.
+     * @return The partition index.
+     */
+    int partition_of(int v) const { return v / range_; }
+
+    int get_vertices() const { return vertices_; } // The number of vertices.
+    int get_partitions() const { return partitions_; } // The number of partitions.
+
+private:
+    int vertices_ = 0; // The number of vertices.
+    int partitions_ = 0; // The number of partitions.
+    int range_ = 1; // Vertices per partition.
+    vector<vector<StreamEdge>> edges_; // In-memory partitions.
+    vector<string> paths_; // Partition files after spill(), empty while in memory.
+};
+
+/**
+ * Builds the partitions from a graph.
+ * @param csr The graph to partition.
+ * @param partitions The number of partitions.
+ */
+void EdgePartitions::build(const CsrGraph& csr, int partitions) {
+    TRACE_SCOPE("EdgePartitions::build");
+    vertices_ = csr.vertices;
+    partitions_ = max(1, partitions);
+    range_ = max(1, (vertices_ + partitions_ - 1) / partitions_);
+    edges_.assign(partitions_, vector<StreamEdge>());
+    paths_.clear();
+    for (int u = 0; u < csr.vertices; u++) {
+        for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+            StreamEdge edge = { u, csr.targets[e], csr.weights[e] };
+            edges_[partition_of(u)].push_back(edge);
+        }
+    }
+}
+
+/**
+ * Moves every partition into its own file.
+ * @param prefix The path prefix.
+ * @return True on success.
+ */
+bool EdgePartitions::spill(const string& prefix) {
+    vector<string> paths;
+    for (int p = 0; p < partitions_; p++) {
+        paths.push_back(prefix + "." + to_string(p));
+        ofstream out(paths.back(), ios::binary);
+        if (!out) return false;
+        if (!edges_[p].empty()) out.write((const char*)edges_[p].data(), edges_[p].size() * sizeof(StreamEdge));
+        if (!out) return false;
+    }
+    paths_ = paths;
+    for (vector<StreamEdge>& part : edges_) vector<StreamEdge>().swap(part);
+    return true;
+}
+
+/**
+ * Runs an edge-centric scatter/shuffle/gather computation in the style of X-Stream.
+ * Every iteration streams all edge partitions once (scatter), appends the produced updates to
+ * the buffer of the destination partition (shuffle), then streams every buffer once (gather).
+ * Vertex state is only touched inside the current partition's range, edges are never accessed randomly.
+ *
+ * A Program provides:
+ *   typedef ... Update;
+ *   bool scatter(const StreamEdge& e, Update& out)   produce an update for e.dst, or return false
+ *   void gather(int dst, const Update& update)       apply an update
+ *   bool finish_iteration()                          return true to run another iteration
+ *
+ * @param edges The partitioned edges.
+ * @param program The vertex program, which owns the vertex state.
+ * @param max_iterations The maximum number of iterations.
+ * @return The number of iterations run.
+ */
+template <typename Program>
+int run_edge_centric(const EdgePartitions& edges, Program& program, int max_iterations) {
+    typedef typename Program::Update Update;
+    int partitions = edges.get_partitions();
+    vector<vector<pair<int, Update>>> buckets(partitions);
+    int iteration = 0;
+    while (iteration < max_iterations) {
+        iteration++;
+        {
+            TRACE_SCOPE("edge_centric/scatter");
+            for (int p = 0; p < partitions; p++) {
+                edges.for_each_edge(p, [&](const StreamEdge& e) {
+                    Update update;
+                    if (program.scatter(e, update)) buckets[edges.partition_of(e.dst)].push_back(make_pair(e.dst, update));
+                });
+            }
+        }
+        {
+            TRACE_SCOPE("edge_centric/gather");
+            for (int p = 0; p < partitions; p++) {
+                for (const pair<int, Update>& u : buckets[p]) program.gather(u.first, u.second);
+                buckets[p].clear();
+            }
+        }
+        if (!program.finish_iteration()) break;
+    }
+    return iteration;
+}
+
+/**
+ * Edge-centric BFS: scatters from the vertices discovered in the previous iteration.
+ */
+struct EdgeCentricBfs {
+    typedef int Update;
+    vector<int> level; // Hop distance from the source, -1 if not reached.
+    int current = 0; // The level being expanded.
+    bool discovered = false; // Whether the current iteration reached a new vertex.
+
+    EdgeCentricBfs(int vertices, int source) : level(vertices, -1) { level[source] = 0; }
+
+    bool scatter(const StreamEdge& e, Update& out) {
+        if (level[e.src] != current) return false;
+        out = current + 1;
+        return true;
+    }
+
+    void gather(int dst, const Update& update) {
+        if (level[dst] == -1) {
+            level[dst] = update;
+            discovered = true;
+        }
+    }
+
+    bool finish_iteration() {
+        current++;
+        bool more = discovered;
+        discovered = false;
+        return more;
+    }
+};
+
+/**
+ * Edge-centric connected components by minimum label propagation over undirected edges.
+ */
+struct EdgeCentricComponents {
+    typedef int Update;
+    vector<int> label; // The smallest vertex index known in the component.
+    vector<uint8_t> changed; // Whether the label changed in the previous iteration.
+    vector<uint8_t> next_changed; // Labels changed in the current iteration.
+    bool any = false; // Whether any label changed in the current iteration.
+
+    EdgeCentricComponents(int vertices) : label(vertices), changed(vertices, 1), next_changed(vertices, 0) {
+        for (int v = 0; v < vertices; v++) label[v] = v;
+    }
+
+    bool scatter(const StreamEdge& e, Update& out) {
+        if (!changed[e.src]) return false;
+        out = label[e.src];
+        return true;
+    }
+
+    void gather(int dst, const Update& update) {
+        if (update < label[dst]) {
+            label[dst] = update;
+            next_changed[dst] = 1;
+            any = true;
+        }
+    }
+
+    bool finish_iteration() {
+        changed.swap(next_changed);
+        fill(next_changed.begin(), next_changed.end(), 0);
+        bool more = any;
+        any = false;
+        return more;
+    }
+};
+
+/**
+ * Edge-centric single-source shortest paths: Bellman-Ford relaxing only edges out of improved vertices.
+ */
+struct EdgeCentricSssp {
+    typedef long long Update;
+    vector<long long> dist; // Distance from the source, -1 if not reached.
+    vector<uint8_t> changed; // Whether the distance improved in the previous iteration.
+    vector<uint8_t> next_changed; // Distances improved in the current iteration.
+    bool any = false; // Whether any distance improved in the current iteration.
+
+    EdgeCentricSssp(int vertices, int source) : dist(vertices, -1), changed(vertices, 0), next_changed(vertices, 0) {
+        dist[source] = 0;
+        changed[source] = 1;
+    }
+
+    bool scatter(const StreamEdge& e, Update& out) {
+        if (!changed[e.src]) return false;
+        out = dist[e.src] + e.weight;
+        return true;
+    }
+
+    void gather(int dst, const Update& update) {
+        if (dist[dst] == -1 || update < dist[dst]) {
+            dist[dst] = update;
+            next_changed[dst] = 1;
+            any = true;
+        }
+    }
+
+    bool finish_iteration() {
+        changed.swap(next_changed);
+        fill(next_changed.begin(), next_changed.end(), 0);
+        bool more = any;
+        any = false;
+        return more;
+    }
+};
+
+/**
+ * Edge-centric PageRank with a fixed number of iterations. Rank of dangling vertices is spread evenly.
+ */
+struct EdgeCentricPageRank {
+    typedef double Update;
+    vector<double> rank; // The current rank of every vertex.
+    vector<double> sum; // Rank received in the current iteration.
+    vector<int> out_degree; // Out-degree of every vertex.
+    double damping; // The damping factor.
+
+    EdgeCentricPageRank(const EdgePartitions& edges, double damping_factor = 0.85)
+        : rank(edges.get_vertices(), 1.0 / max(1, edges.get_vertices())), sum(edges.get_vertices(), 0.0),
+        out_degree(edges.get_vertices(), 0), damping(damping_factor) {
+        // One extra sequential pass to learn the degrees.
+        for (int p = 0; p < edges.get_partitions(); p++) {
+            edges.for_each_edge(p, [&](const StreamEdge& e) { out_degree[e.src]++; });
+        }
+    }
+
+    bool scatter(const StreamEdge& e, Update& out) {
+        out = rank[e.src] / out_degree[e.src];
+        return true;
+    }
+
+    void gather(int dst, const Update& update) { sum[dst] += update; }
+
+    bool finish_iteration() {
+        int n = (int)rank.size();
+        double dangling = 0;
+        for (int v = 0; v < n; v++) if (out_degree[v] == 0) dangling += rank[v];
+        for (int v = 0; v < n; v++) {
+            rank[v] = (1.0 - damping) / n + damping * (sum[v] + dangling / n);
+            sum[v] = 0;
+        }
+        return true;
+    }
+};
+
+/**
+ * A fixed pool of threads running parallel loops with work stealing.
+ * A loop is cut into chunks that are dealt round-robin to per-thread deques, every thread takes
+ * chunks from the back of its own deque and, when it runs dry, steals from the front of the others.
+ * The calling thread works as thread 0.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * Starts the worker threads.
+     *
+     * @param threads The total number of threads including the caller, 0 means hardware concurrency.
+     */
+    explicit WorkStealingPool(int threads = 0);
+
+    /**
+     * Stops and joins the worker threads.
+     */
+    ~WorkStealingPool();
+
+    /**
+     * Runs body(begin, end) over [0, n) in chunks of at most grain indices and waits for all of them.
+     *
+     * @param n The number of indices.
+     * @param grain The chunk size.
+     * @param body The loop body.
+     */
+    void parallel_for(int n, int grain, const function<void(int, int)>& body);
+
+    /**
+     * Returns the number of threads, including the caller.
+     *
+     * @return The pool size.
+     */
+    int size() const { return (int)queues_.size(); }
+
+private:
+    struct TaskQueue {
+        mutex lock; // Guards tasks.
+        deque<pair<int, int>> tasks; // Chunks as [begin, end) ranges.
+    };
+
+    vector<thread> workers_; // Threads 1 .. size - 1.
+    vector<unique_ptr<TaskQueue>> queues_; // One deque per thread.
+    mutex mutex_; // Guards generation_, stop_ and the condition variables.
+    condition_variable wake_; // Signalled when a loop starts or the pool stops.
+    condition_variable done_; // Signalled when the last chunk finishes.
+    const function<void(int, int)>* body_ = nullptr; // The body of the running loop.
+    long long generation_ = 0; // Incremented for every loop.
+    atomic<int> remaining_; // Chunks of the running loop not yet finished.
+    bool stop_ = false; // Whether the pool is shutting down.
+
+    /**
+     * Runs one chunk, from the own deque or stolen from another thread.
+     *
+     * @param id The thread number.
+     * @return True if a chunk was run, false if every deque was empty.
+     */
+    bool run_one(int id);
+
+    /**
+     * The loop of a worker thread.
+     *
+     * @param id The thread number.
+     */
+    void worker(int id);
+};
+
+/**
+ * Starts the worker threads.
+ * @param threads The total number of threads including the caller.
+ */
+WorkStealingPool::WorkStealingPool(int threads) : remaining_(0) {
+    if (threads <= 0) threads = max(1, (int)thread::hardware_concurrency());
+    for (int t = 0; t < threads; t++) queues_.emplace_back(new TaskQueue());
+    for (int t = 1; t < threads; t++) workers_.emplace_back(&WorkStealingPool::worker, this, t);
+}
+
+/**
+ * Stops and joins the worker threads.
+ */
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (thread& t : workers_) t.join();
+}
+
+/**
+ * Runs one chunk, from the own deque or stolen from another thread.
+ * @param id The thread number.
+ * @return True if a chunk was run.
+ */
+bool WorkStealingPool::run_one(int id) {
+    pair<int, int> task;
+    bool found = false;
+    int n = (int)queues_.size();
+    for (int k = 0; k < n && !found; k++) {
+        TaskQueue& q = *queues_[(id + k) % n];
+        lock_guard<mutex> lock(q.lock);
+        if (q.tasks.empty()) continue;
+        if (k == 0) {
+            task = q.tasks.back();
+            q.tasks.pop_back();
+        }
+        else {
+            task = q.tasks.front();
+            q.tasks.pop_front();
+        }
+        found = true;
+    }
+    if (!found) return false;
+    (*body_)(task.first, task.second);
+    if (remaining_.fetch_sub(1) == 1) {
+        lock_guard<mutex> lock(mutex_);
+        done_.notify_all();
+    }
+    return true;
+}
+
+/**
+ * The loop of a worker thread.
+ * @param id The thread number.
+ */
+void WorkStealingPool::worker(int id) {
+    long long seen = 0;
+    for (;;) {
+        {
+            unique_lock<mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+        while (run_one(id)) {}
+    }
+}
+
+/**
+ * Runs a parallel loop and waits for it.
+ * @param n The number of indices.
+ * @param grain The chunk size.
+ * @param body The loop body.
+ */
+void WorkStealingPool::parallel_for(int n, int grain, const function<void(int, int)>& body) {
+    if (n <= 0) return;
+    grain = max(1, grain);
+    int chunks = (n + grain - 1) / grain;
+    body_ = &body;
+    remaining_ = chunks;
+    for (int c = 0; c < chunks; c++) {
+        TaskQueue& q = *queues_[c % queues_.size()];
+        lock_guard<mutex> lock(q.lock);
+        q.tasks.push_back(make_pair(c * grain, min(n, (c + 1) * grain)));
+    }
+    {
+        lock_guard<mutex> lock(mutex_);
+        generation_++;
+    }
+    wake_.notify_all();
+    while (run_one(0)) {}
+    unique_lock<mutex> lock(mutex_);
+    done_.wait(lock, [&] { return remaining_.load() == 0; });
+}
+
+/**
+ * Combines messages to the same vertex by keeping the smallest.
+ */
+template <typename M>
+struct MinCombiner {
+    static M combine(M a, M b) { return a < b ? a : b; }
+};
+
+/**
+ * Combines messages to the same vertex by adding them.
+ */
+template <typename M>
+struct SumCombiner {
+    static M combine(M a, M b) { return a + b; }
+};
+
+/**
+ * The interface a vertex program sees during compute().
+ */
+template <typename Message, typename Combiner>
+class PregelContext {
+public:
+    /**
+     * Constructor for the PregelContext class.
+     *
+     * @param graph The graph being processed.
+     * @param outbox Combined messages for the next superstep, one slot per vertex, reset to the combiner identity.
+     * @param has_message Whether each outbox slot holds a message.
+     * @param halted Whether each vertex voted to halt.
+     * @param superstep The current superstep.
+     * @param aggregated The sum aggregated in the previous superstep.
+     */
+    PregelContext(const CsrGraph& graph, atomic<Message>* outbox, atomic<uint8_t>* has_message, vector<uint8_t>& halted, int superstep, double aggregated)
+        : graph_(graph), outbox_(outbox), has_message_(has_message), halted_(halted), superstep_(superstep), aggregated_(aggregated) {}
+
+    /**
+     * Returns the current superstep, starting at 0.
+     *
+     * @return The superstep number.
+     */
+    int superstep() const { return superstep_; }
+
+    /**
+     * Returns the graph being processed.
+     *
+     * @return The graph.
+     */
+    const CsrGraph& graph() const { return graph_; }
+
+    /**
+     * Sends a message to a vertex for the next superstep, combining it in place with any earlier message.
+     *
+     * @param dst The receiving vertex.
+     * @param message The message.
+     */
+    void send(int dst, Message message) {
+        has_message_[dst].store(1, memory_order_relaxed);
+        Message expected = outbox_[dst].load(memory_order_relaxed);
+        while (!outbox_[dst].compare_exchange_weak(expected, Combiner::combine(expected, message))) {}
+    }
+
+    /**
+     * Deactivates a vertex until it receives a message.
+     *
+     * @param v The vertex.
+     */
+    void vote_to_halt(int v) { halted_[v] = 1; }
+
+    /**
+     * Adds a value to the global sum aggregator. The total becomes visible through aggregated() in the next superstep.
+     *
+     * @param value The value to add.
+     */
+    void aggregate(double value) { partial_ += value; }
+
+    /**
+     * Returns the sum of all values passed to aggregate() in the previous superstep.
+     *
+     * @return The aggregated sum, 0 in superstep 0.
+     */
+    double aggregated() const { return aggregated_; }
+
+    /**
+     * Returns the sum aggregated through this context, which run_pregel folds into the global total.
+     *
+     * @return The partial sum.
+     */
+    double partial() const { return partial_; }
+
+private:
+    const CsrGraph& graph_; // The graph being processed.
+    atomic<Message>* outbox_; // Combined outgoing messages.
+    atomic<uint8_t>* has_message_; // Outgoing message flags.
+    vector<uint8_t>& halted_; // Halt votes.
+    int superstep_; // The current superstep.
+    double aggregated_; // The aggregator total of the previous superstep.
+    double partial_ = 0; // The aggregator sum of this context.
+};
+
+/**
+ * Runs a vertex program in bulk synchronous supersteps, in the style of Pregel.
+ * In every superstep each active vertex, or halted vertex that received a message, runs
+ * compute() once on the pool. Messages are combined on arrival into a per-vertex slot of a
+ * double-buffered array, so sending never allocates. Every chunk of vertices gets its own context,
+ * whose aggregator sum is added to the superstep total once at the end of the chunk. The run ends when
+ * every vertex has voted to halt and no messages are in flight.
+ *
+ * A Program provides:
+ *   typedef ... Value; typedef ... Message; typedef ... Combiner;
+ *   Message identity()                            the neutral element the slots are reset to
+ *   void init(int v, Value& value)
+ *   void compute(PregelContext<Message, Combiner>& ctx, int v, Value& value, const Message* message)
+ *
+ * @param graph The graph to process.
+ * @param program The vertex program.
+ * @param values Receives the final value of every vertex.
+ * @param pool The thread pool to run on.
+ * @param max_supersteps The maximum number of supersteps.
+ * @return The number of supersteps run.
+ */
+template <typename Program>
+int run_pregel(const CsrGraph& graph, Program& program, vector<typename Program::Value>& values, WorkStealingPool& pool, int max_supersteps) {
+    typedef typename Program::Message Message;
+    typedef typename Program::Combiner Combiner;
+    int n = graph.vertices;
+    values.resize(n);
+    for (int v = 0; v < n; v++) program.init(v, values[v]);
+
+    unique_ptr<atomic<Message>[]> inbox(new atomic<Message>[n]);
+    unique_ptr<atomic<Message>[]> outbox(new atomic<Message>[n]);
+    unique_ptr<atomic<uint8_t>[]> in_flag(new atomic<uint8_t>[n]);
+    unique_ptr<atomic<uint8_t>[]> out_flag(new atomic<uint8_t>[n]);
+    for (int v = 0; v < n; v++) {
+        inbox[v] = outbox[v] = program.identity();
+        in_flag[v] = out_flag[v] = 0;
+    }
+    vector<uint8_t> halted(n, 0);
+    int grain = max(64, n / (pool.size() * 8));
+
+    int superstep = 0;
+    double aggregated = 0;
+    for (; superstep < max_supersteps; superstep++) {
+        TRACE_SCOPE("pregel/superstep");
+        atomic<int> active(0);
+        mutex aggregate_mutex;
+        double aggregate_total = 0;
+        pool.parallel_for(n, grain, [&](int begin, int end) {
+            PregelContext<Message, Combiner> ctx(graph, outbox.get(), out_flag.get(), halted, superstep, aggregated);
+            int local = 0;
+            for (int v = begin; v < end; v++) {
+                bool received = in_flag[v].load(memory_order_relaxed) != 0;
+                if (halted[v] && !received) continue;
+                halted[v] = 0;
+                Message message = inbox[v].load(memory_order_relaxed);
+                program.compute(ctx, v, values[v], received ? &message : nullptr);
+                if (!halted[v]) local++;
+                inbox[v].store(program.identity(), memory_order_relaxed);
+                in_flag[v].store(0, memory_order_relaxed);
+            }
+            active += local;
+            if (ctx.partial() != 0) {
+                lock_guard<mutex> lock(aggregate_mutex);
+                aggregate_total += ctx.partial();
+            }
+        });
+        aggregated = aggregate_total;
+        swap(inbox, outbox);
+        swap(in_flag, out_flag);
+        bool messages = false;
+        for (int v = 0; v < n && !messages; v++) messages = in_flag[v].load(memory_order_relaxed) != 0;
+        if (active == 0 && !messages) {
+            superstep++;
+            break;
+        }
+    }
+    return superstep;
+}
+
+/**
+ * Pregel BFS: a vertex takes the first level it hears about and tells its neighbours.
+ */
+struct PregelBfs {
+    typedef int Value;
+    typedef int Message;
+    typedef MinCombiner<int> Combiner;
+    int source; // The source vertex.
+
+    explicit PregelBfs(int source_vertex) : source(source_vertex) {}
+    Message identity() const { return INT_MAX; }
+    void init(int, Value& value) { value = -1; }
+
+    void compute(PregelContext<Message, Combiner>& ctx, int v, Value& value, const Message* message) {
+        int level = ctx.superstep() == 0 && v == source ? 0 : (message != nullptr && value == -1 ? *message : -1);
+        if (level != -1) {
+            value = level;
+            const CsrGraph& g = ctx.graph();
+            for (int e = g.offsets[v]; e < g.offsets[v + 1]; e++) ctx.send(g.targets[e], level + 1);
+        }
+        ctx.vote_to_halt(v);
+    }
+};
+
+/**
+ * Pregel single-source shortest paths with the min combiner.
+ */
+struct PregelSssp {
+    typedef long long Value;
+    typedef long long Message;
+    typedef MinCombiner<long long> Combiner;
+    int source; // The source vertex.
+
+    explicit PregelSssp(int source_vertex) : source(source_vertex) {}
+    Message identity() const { return LLONG_MAX; }
+    void init(int, Value& value) { value = -1; }
+
+    void compute(PregelContext<Message, Combiner>& ctx, int v, Value& value, const Message* message) {
+        long long candidate = ctx.superstep() == 0 && v == source ? 0 : (message != nullptr ? *message : -1);
+        if (candidate != -1 && (value == -1 || candidate < value)) {
+            value = candidate;
+            const CsrGraph& g = ctx.graph();
+            for (int e = g.offsets[v]; e < g.offsets[v + 1]; e++) ctx.send(g.targets[e], value + g.weights[e]);
+        }
+        ctx.vote_to_halt(v);
+    }
+};
+
+/**
+ * Pregel connected components: every vertex adopts the smallest label it hears about.
+ */
+struct PregelComponents {
+    typedef int Value;
+    typedef int Message;
+    typedef MinCombiner<int> Combiner;
+
+    Message identity() const { return INT_MAX; }
+    void init(int v, Value& value) { value = v; }
+
+    void compute(PregelContext<Message, Combiner>& ctx, int v, Value& value, const Message* message) {
+        bool changed = ctx.superstep() == 0;
+        if (message != nullptr && *message < value) {
+            value = *message;
+            changed = true;
+        }
+        if (changed) {
+            const CsrGraph& g = ctx.graph();
+            for (int e = g.offsets[v]; e < g.offsets[v + 1]; e++) ctx.send(g.targets[e], value);
+        }
+        ctx.vote_to_halt(v);
+    }
+};
+
+/**
+ * Pregel PageRank for a fixed number of supersteps. Dangling vertices hand their rank to the
+ * sum aggregator, and it is spread evenly over all vertices in the next superstep.
+ */
+struct PregelPageRank {
+    typedef double Value;
+    typedef double Message;
+    typedef SumCombiner<double> Combiner;
+    int iterations; // The number of rank updates.
+    double damping; // The damping factor.
+    int vertices; // The number of vertices.
+
+    PregelPageRank(int vertex_count, int iteration_count, double damping_factor = 0.85)
+        : iterations(iteration_count), damping(damping_factor), vertices(max(1, vertex_count)) {}
+    Message identity() const { return 0.0; }
+    void init(int, Value& value) { value = 1.0 / vertices; }
+
+    void compute(PregelContext<Message, Combiner>& ctx, int v, Value& value, const Message* message) {
+        if (ctx.superstep() > 0) {
+            value = (1.0 - damping) / vertices + damping * ((message != nullptr ? *message : 0.0) + ctx.aggregated() / vertices);
+        }
+        const CsrGraph& g = ctx.graph();
+        if (ctx.superstep() < iterations) {
+            if (g.degree(v) == 0) {
+                ctx.aggregate(value);
+            } else {
+                double share = value / g.degree(v);
+                for (int e = g.offsets[v]; e < g.offsets[v + 1]; e++) ctx.send(g.targets[e], share);
+            }
+        }
+        if (ctx.superstep() >= iterations) ctx.vote_to_halt(v);
+    }
+};
+
+/**
+ * A sparse adjacency matrix kept in both CSR (rows) and CSC (columns) form, the storage
+ * behind the GraphBLAS-style vector-matrix products below. Entries hold edge weights.
+ */
+struct SparseMatrix {
+    int n = 0; // The number of rows and columns.
+    vector<int> row_offsets; // CSR offsets.
+    vector<int> row_cols; // Column of every CSR entry.
+    vector<int> row_vals; // Value of every CSR entry.
+    vector<int> col_offsets; // CSC offsets.
+    vector<int> col_rows; // Row of every CSC entry.
+    vector<int> col_vals; // Value of every CSC entry.
+
+    /**
+     * Builds the matrix from a graph.
+     *
+     * @param csr The graph, entry (u, v) is the weight of the edge u->v.
+     * @param pattern_only Whether to store 1 for every entry instead of the weight.
+     */
+    void build(const CsrGraph& csr, bool pattern_only = false) {
+        n = csr.vertices;
+        row_offsets = csr.offsets;
+        row_cols = csr.targets;
+        row_vals = csr.weights;
+        if (pattern_only) fill(row_vals.begin(), row_vals.end(), 1);
+        col_offsets.assign(n + 1, 0);
+        for (int v : row_cols) col_offsets[v + 1]++;
+        for (int v = 0; v < n; v++) col_offsets[v + 1] += col_offsets[v];
+        col_rows.resize(row_cols.size());
+        col_vals.resize(row_cols.size());
+        vector<int> cursor(col_offsets.begin(), col_offsets.end() - 1);
+        for (int u = 0; u < n; u++) {
+            for (int e = row_offsets[u]; e < row_offsets[u + 1]; e++) {
+                int pos = cursor[row_cols[e]]++;
+                col_rows[pos] = u;
+                col_vals[pos] = row_vals[e];
+            }
+        }
+    }
+};
+
+/**
+ * The boolean (or, and) semiring, used for reachability and BFS.
+ */
+struct BoolOrAndSemiring {
+    typedef uint8_t Value;
+    static Value zero() { return 0; }
+    static Value add(Value a, Value b) { return a | b; }
+    static Value multiply(Value x, int) { return x; }
+    static bool terminal(Value a) { return a != 0; } // Once true, further additions can not change the result.
+};
+
+/**
+ * The tropical (min, +) semiring, used for shortest paths.
+ */
+struct MinPlusSemiring {
+    typedef long long Value;
+    static Value zero() { return LLONG_MAX; }
+    static Value add(Value a, Value b) { return a < b ? a : b; }
+    static Value multiply(Value x, int a) { return x == LLONG_MAX ? x : x + a; }
+    static bool terminal(Value) { return false; }
+};
+
+/**
+ * The arithmetic (+, *) semiring, used for PageRank.
+ */
+struct PlusTimesSemiring {
+    typedef double Value;
+    static Value zero() { return 0.0; }
+    static Value add(Value a, Value b) { return a + b; }
+    static Value multiply(Value x, int a) { return x * a; }
+    static bool terminal(Value) { return false; }
+};
+
+/**
+ * A vector with an explicit set of stored entries. The stored indices are kept both as a list,
+ * for sparse (push) kernels, and as per-index flags, for dense (pull) kernels and masks.
+ */
+template <typename T>
+struct GrbVector {
+    int n = 0; // The dimension.
+    vector<T> values; // Value of every index, meaningful only where present.
+    vector<uint8_t> present; // Whether each index is stored.
+    vector<int> indices; // The stored indices, unordered.
+
+    GrbVector() {}
+    explicit GrbVector(int size, T fill_value = T()) : n(size), values(size, fill_value), present(size, 0) {}
+
+    /**
+     * Stores an entry, overwriting an existing one.
+     *
+     * @param i The index.
+     * @param value The value.
+     */
+    void set(int i, T value) {
+        if (!present[i]) {
+            present[i] = 1;
+            indices.push_back(i);
+        }
+        values[i] = value;
+    }
+
+    /**
+     * Removes every stored entry in O(nnz).
+     */
+    void clear() {
+        for (int i : indices) present[i] = 0;
+        indices.clear();
+    }
+
+    /**
+     * Returns the number of stored entries.
+     *
+     * @return The number of non-zeros.
+     */
+    int nnz() const { return (int)indices.size(); }
+
+    /**
+     * Exchanges the contents with another vector in O(1).
+     *
+     * @param other The vector to swap with.
+     */
+    void swap(GrbVector& other) {
+        std::swap(n, other.n);
+        values.swap(other.values);
+        present.swap(other.present);
+        indices.swap(other.indices);
+    }
+};
+
+/**
+ * Computes w<mask> = x (+.*) A with the given semiring, where x is a row vector and A the matrix.
+ * Only indices allowed by the structural mask are computed; with complement_mask the mask is inverted.
+ * A sparse x is pushed along the rows of its stored entries, and the products are accumulated in
+ * parallel per output column range into w as a sparse accumulator (SpMSpV); a dense x is pulled
+ * along the columns of the allowed outputs (SpMV). The direction is picked automatically from the
+ * work each would do, or forced with direction (1 push, 2 pull).
+ *
+ * @param x The input vector.
+ * @param a The matrix.
+ * @param mask The structural mask, or nullptr for none.
+ * @param complement_mask Whether the mask is inverted.
+ * @param pool The thread pool to run on.
+ * @param direction 0 for automatic, 1 to force push, 2 to force pull.
+ * @param w Receives the product. A vector of the right size is cleared in O(nnz), so iterative
+ * callers can reuse one buffer and keep push rounds proportional to the frontier. Must not alias x.
+ */
+template <typename Semiring, typename M>
+void grb_vxm(const GrbVector<typename Semiring::Value>& x, const SparseMatrix& a,
+    const GrbVector<M>* mask, bool complement_mask, WorkStealingPool& pool, int direction, GrbVector<typename Semiring::Value>& w) {
+    typedef typename Semiring::Value T;
+    TRACE_SCOPE("grb_vxm");
+    if (w.n != a.n) w = GrbVector<T>(a.n, Semiring::zero());
+    else w.clear();
+    auto allowed = [&](int j) { return mask == nullptr || (mask->present[j] != 0) != complement_mask; };
+
+    if (direction == 0) {
+        // Push touches the out-edges of the stored inputs, pull the in-edges of the allowed outputs.
+        long long push_work = 0;
+        for (int i : x.indices) push_work += a.row_offsets[i + 1] - a.row_offsets[i];
+        long long pull_work = mask == nullptr ? (long long)a.row_cols.size()
+            : (complement_mask ? (long long)a.row_cols.size() * (a.n - mask->nnz()) / max(1, a.n) : (long long)a.row_cols.size() * mask->nnz() / max(1, a.n));
+        direction = push_work <= pull_work ? 1 : 2;
+    }
+
+    if (direction == 1) {
+        // Every thread multiplies a share of the stored inputs and buckets the products by output column range.
+        // Each bucket is then accumulated in parallel into w, which serves as the sparse accumulator:
+        // a bucket owns its columns, so the writes need no synchronization.
+        int parts = pool.size();
+        int buckets = parts * 4;
+        int width = max(1, (a.n + buckets - 1) / buckets);
+        int grain = max(1, (x.nnz() + parts - 1) / parts);
+        vector<vector<vector<pair<int, T>>>> products((x.nnz() + grain - 1) / grain, vector<vector<pair<int, T>>>(buckets));
+        pool.parallel_for(x.nnz(), grain, [&](int begin, int end) {
+            vector<vector<pair<int, T>>>& out = products[begin / grain];
+            for (int k = begin; k < end; k++) {
+                int i = x.indices[k];
+                for (int e = a.row_offsets[i]; e < a.row_offsets[i + 1]; e++) {
+                    int j = a.row_cols[e];
+                    if (allowed(j)) out[j / width].push_back(make_pair(j, Semiring::multiply(x.values[i], a.row_vals[e])));
+                }
+            }
+        });
+        vector<vector<int>> stored(buckets);
+        pool.parallel_for(buckets, 1, [&](int begin, int end) {
+            for (int b = begin; b < end; b++) {
+                for (const vector<vector<pair<int, T>>>& part : products) {
+                    for (const pair<int, T>& p : part[b]) {
+                        int j = p.first;
+                        if (w.present[j]) {
+                            w.values[j] = Semiring::add(w.values[j], p.second);
+                        } else {
+                            w.values[j] = p.second;
+                            w.present[j] = 1;
+                            stored[b].push_back(j);
+                        }
+                    }
+                }
+            }
+        });
+        for (const vector<int>& part : stored) w.indices.insert(w.indices.end(), part.begin(), part.end());
+        return;
+    }
+
+    // Pull: every output column is owned by one chunk, so the writes need no synchronization.
+    const int grain = 1024;
+    vector<vector<int>> stored((a.n + grain - 1) / grain);
+    pool.parallel_for(a.n, grain, [&](int begin, int end) {
+        vector<int>& out = stored[begin / grain];
+        for (int j = begin; j < end; j++) {
+            if (!allowed(j)) continue;
+            T sum = Semiring::zero();
+            bool any = false;
+            for (int e = a.col_offsets[j]; e < a.col_offsets[j + 1]; e++) {
+                int i = a.col_rows[e];
+                if (!x.present[i]) continue;
+                sum = any ? Semiring::add(sum, Semiring::multiply(x.values[i], a.col_vals[e])) : Semiring::multiply(x.values[i], a.col_vals[e]);
+                any = true;
+                if (Semiring::terminal(sum)) break;
+            }
+            if (any) {
+                w.values[j] = sum;
+                w.present[j] = 1;
+                out.push_back(j);
+            }
+        }
+    });
+    for (const vector<int>& part : stored) w.indices.insert(w.indices.end(), part.begin(), part.end());
+}
+
+/**
+ * Computes w<mask> = x (+.*) A into a new vector, see the overload taking the output.
+ *
+ * @param x The input vector.
+ * @param a The matrix.
+ * @param mask The structural mask, or nullptr for none.
+ * @param complement_mask Whether the mask is inverted.
+ * @param pool The thread pool to run on.
+ * @param direction 0 for automatic, 1 to force push, 2 to force pull.
+ * @return The product vector.
+ */
+template <typename Semiring, typename M>
+GrbVector<typename Semiring::Value> grb_vxm(const GrbVector<typename Semiring::Value>& x, const SparseMatrix& a,
+    const GrbVector<M>* mask, bool complement_mask, WorkStealingPool& pool, int direction = 0) {
+    GrbVector<typename Semiring::Value> w;
+    grb_vxm<Semiring, M>(x, a, mask, complement_mask, pool, direction, w);
+    return w;
+}
+
+/**
+ * BFS as repeated masked boolean SpMSpV: the next frontier is frontier (or.and) A restricted to unvisited vertices.
+ *
+ * @param a The adjacency matrix.
+ * @param source The source vertex.
+ * @param pool The thread pool to run on.
+ * @return The hop distance of every vertex, -1 if unreachable.
+ */
+vector<int> grb_bfs(const SparseMatrix& a, int source, WorkStealingPool& pool) {
+    TRACE_SCOPE("grb_bfs");
+    vector<int> level(a.n, -1);
+    GrbVector<uint8_t> visited(a.n, 0);
+    GrbVector<uint8_t> frontier(a.n, 0);
+    GrbVector<uint8_t> next(a.n, 0);
+    frontier.set(source, 1);
+    visited.set(source, 1);
+    level[source] = 0;
+    for (int depth = 1; frontier.nnz() > 0; depth++) {
+        grb_vxm<BoolOrAndSemiring>(frontier, a, &visited, true, pool, 0, next);
+        frontier.swap(next);
+        for (int v : frontier.indices) {
+            visited.set(v, 1);
+            level[v] = depth;
+        }
+    }
+    return level;
+}
+
+/**
+ * Single-source shortest paths as Bellman-Ford over the (min, +) semiring.
+ * Only vertices whose distance improved are multiplied in the next round.
+ *
+ * @param a The weighted adjacency matrix.
+ * @param source The source vertex.
+ * @param pool The thread pool to run on.
+ * @return The distance of every vertex, -1 if unreachable.
+ */
+vector<long long> grb_sssp(const SparseMatrix& a, int source, WorkStealingPool& pool) {
+    TRACE_SCOPE("grb_sssp");
+    vector<long long> dist(a.n, LLONG_MAX);
+    GrbVector<long long> changed(a.n, LLONG_MAX);
+    GrbVector<long long> relaxed(a.n, LLONG_MAX);
+    dist[source] = 0;
+    changed.set(source, 0);
+    for (int round = 0; round < a.n && changed.nnz() > 0; round++) {
+        grb_vxm<MinPlusSemiring, uint8_t>(changed, a, nullptr, false, pool, 0, relaxed);
+        changed.clear();
+        for (int v : relaxed.indices) {
+            if (relaxed.values[v] < dist[v]) {
+                dist[v] = relaxed.values[v];
+                changed.set(v, dist[v]);
+            }
+        }
+    }
+    for (long long& d : dist) if (d == LLONG_MAX) d = -1;
+    return dist;
+}
+
+/**
+ * PageRank as repeated (+, *) products: r = (1 - d) / n + d * (r ./ outdegree) A.
+ * Rank of dangling vertices is spread evenly.
+ *
+ * @param a The adjacency matrix, built with pattern_only.
+ * @param iterations The number of iterations.
+ * @param pool The thread pool to run on.
+ * @param damping The damping factor. Default is 0.85.
+ * @return The rank of every vertex.
+ */
+vector<double> grb_pagerank(const SparseMatrix& a, int iterations, WorkStealingPool& pool, double damping = 0.85) {
+    TRACE_SCOPE("grb_pagerank");
+    int n = max(1, a.n);
+    vector<double> rank(a.n, 1.0 / n);
+    GrbVector<double> share(a.n, 0.0);
+    GrbVector<double> sum(a.n, 0.0);
+    for (int it = 0; it < iterations; it++) {
+        share.clear();
+        double dangling = 0;
+        for (int v = 0; v < a.n; v++) {
+            int degree = a.row_offsets[v + 1] - a.row_offsets[v];
+            if (degree > 0) share.set(v, rank[v] / degree);
+            else dangling += rank[v];
+        }
+        grb_vxm<PlusTimesSemiring, uint8_t>(share, a, nullptr, false, pool, 0, sum);
+        for (int v = 0; v < a.n; v++) {
+            rank[v] = (1.0 - damping) / n + damping * ((sum.present[v] ? sum.values[v] : 0.0) + dangling / n);
+        }
+    }
+    return rank;
+}
+
+/**
+ * Builds a CSR graph from an edge list with a counting sort, without going through the adjacency matrix of Graph.
+ * For undirected graphs every edge is stored in both directions.
+ *
+ * @param vertices The number of vertices.
+ * @param directed Whether the graph is directed.
+ * @param edges The edges. Duplicates are kept.
+ * @return The CSR graph.
+ */
+CsrGraph build_csr_from_edges(int vertices, bool directed, const vector<StreamEdge>& edges) {
+    CsrGraph csr;
+    csr.vertices = vertices;
+    csr.directed = directed;
+    csr.offsets.assign(vertices + 1, 0);
+    for (const StreamEdge& e : edges) {
+        csr.offsets[e.src + 1]++;
+        if (!directed) csr.offsets[e.dst + 1]++;
+    }
+    for (int v = 0; v < vertices; v++) csr.offsets[v + 1] += csr.offsets[v];
+    csr.targets.resize(csr.offsets[vertices]);
+    csr.weights.resize(csr.offsets[vertices]);
+    vector<int> cursor(csr.offsets.begin(), csr.offsets.end() - 1);
+    for (const StreamEdge& e : edges) {
+        int pos = cursor[e.src]++;
+        csr.targets[pos] = e.dst;
+        csr.weights[pos] = e.weight;
+        if (!directed) {
+            pos = cursor[e.dst]++;
+            csr.targets[pos] = e.src;
+            csr.weights[pos] = e.weight;
+        }
+    }
+    return csr;
+}
+
+/**
+ * A graph embedded in 2D or 3D space. Edge weights are Euclidean lengths multiplied by scale
+ * and rounded up, so scaled straight-line distance never overestimates a path and is an admissible A* heuristic.
+ */
+struct SpatialGraph {
+    CsrGraph graph; // The undirected graph with scaled integer lengths as weights.
+    int dims = 2; // The number of coordinates per vertex, 2 or 3.
+    vector<double> coords; // dims coordinates per vertex.
+    double scale = 1000; // The factor between Euclidean length and weight.
+
+    /**
+     * Returns the Euclidean distance between two vertices.
+     *
+     * @param u The first vertex.
+     * @param v The second vertex.
+     * @return The unscaled distance.
+     */
+    double distance(int u, int v) const {
+        double sum = 0;
+        for (int d = 0; d < dims; d++) {
+            double delta = coords[u * dims + d] - coords[v * dims + d];
+            sum += delta * delta;
+        }
+        return sqrt(sum);
+    }
+
+    /**
+     * Returns a lower bound on the weight of any path between two vertices.
+     *
+     * @param u The first vertex.
+     * @param v The second vertex.
+     * @return The scaled distance, rounded down.
+     */
+    int heuristic(int u, int v) const { return (int)floor(distance(u, v) * scale); }
+
+    /**
+     * Returns the weight of an edge of the given Euclidean length.
+     *
+     * @param length The unscaled length.
+     * @return The scaled length, rounded up, at least 1.
+     */
+    int weight_of(double length) const { return max(1, (int)ceil(length * scale)); }
+};
+
+/**
+ * Generates a random geometric graph: points uniform in the unit square or cube,
+ * joined when they are at most radius apart. Points are bucketed into cells of side radius
+ * with a counting sort, so only the 3^dims neighbouring cells are searched and the cost is O(n + m).
+ *
+ * @param vertices The number of points.
+ * @param dims 2 or 3.
+ * @param radius The connection radius.
+ * @param seed The random seed.
+ * @param scale The factor between Euclidean length and weight. Default is 1000.
+ * @return The generated graph.
+ */
+SpatialGraph random_geometric_graph(int vertices, int dims, double radius, unsigned seed, double scale = 1000) {
+    TRACE_SCOPE("random_geometric_graph");
+    SpatialGraph g;
+    g.dims = dims;
+    g.scale = scale;
+    g.coords.resize((size_t)vertices * dims);
+    mt19937 rng(seed);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (double& c : g.coords) c = unit(rng);
+
+    // Cells must be at least radius wide, and there should be no more cells than about one per point.
+    double per_point = ceil(pow((double)max(1, vertices), 1.0 / dims));
+    int side = max(1, (int)min(floor(1.0 / radius), per_point));
+    int cells = dims == 2 ? side * side : side * side * side;
+    auto cell_coord = [&](double x) { return min(side - 1, (int)(x * side)); };
+    vector<int> cell_of(vertices);
+    vector<int> cell_start(cells + 1, 0);
+    for (int v = 0; v < vertices; v++) {
+        int c = 0;
+        for (int d = dims - 1; d >= 0; d--) c = c * side + cell_coord(g.coords[(size_t)v * dims + d]);
+        cell_of[v] = c;
+        cell_start[c + 1]++;
+    }
+    for (int c = 0; c < cells; c++) cell_start[c + 1] += cell_start[c];
+    vector<int> members(vertices);
+    vector<int> cursor(cell_start.begin(), cell_start.end() - 1);
+    for (int v = 0; v < vertices; v++) members[cursor[cell_of[v]]++] = v;
+
+    vector<StreamEdge> edges;
+    int reach[3] = {0, 0, 0};
+    for (int v = 0; v < vertices; v++) {
+        int base[3] = {0, 0, 0};
+        for (int d = 0; d < dims; d++) base[d] = cell_coord(g.coords[(size_t)v * dims + d]);
+        int zs = dims == 3 ? 1 : 0;
+        for (reach[2] = -zs; reach[2] <= zs; reach[2]++) {
+            for (reach[1] = -1; reach[1] <= 1; reach[1]++) {
+                for (reach[0] = -1; reach[0] <= 1; reach[0]++) {
+                    int c = 0;
+                    bool inside = true;
+                    for (int d = dims - 1; d >= 0; d--) {
+                        int x = base[d] + reach[d];
+                        if (x < 0 || x >= side) inside = false;
+                        c = c * side + x;
+                    }
+                    if (!inside) continue;
+                    for (int i = cell_start[c]; i < cell_start[c + 1]; i++) {
+                        int u = members[i];
+                        if (u <= v) continue;
+                        double length = g.distance(u, v);
+                        if (length <= radius) edges.push_back({v, u, g.weight_of(length)});
+                    }
+                }
+            }
+        }
+    }
+    g.graph = build_csr_from_edges(vertices, false, edges);
+    return g;
+}
+
+/**
+ * Generates a road-like graph: a rows x cols grid with jittered vertex positions, some grid edges removed
+ * and some diagonal shortcuts added. Vertex r * cols + c sits near (c, r) / max(rows, cols).
+ *
+ * @param rows The number of grid rows.
+ * @param cols The number of grid columns.
+ * @param jitter The maximum displacement of a vertex, in grid cells.
+ * @param removal The probability of dropping a grid edge.
+ * @param diagonal The probability of adding a diagonal edge to a cell.
+ * @param seed The random seed.
+ * @param scale The factor between Euclidean length and weight. Default is 1000.
+ * @return The generated graph.
+ */
+SpatialGraph perturbed_grid_graph(int rows, int cols, double jitter, double removal, double diagonal, unsigned seed, double scale = 1000) {
+    TRACE_SCOPE("perturbed_grid_graph");
+    SpatialGraph g;
+    g.dims = 2;
+    g.scale = scale;
+    int vertices = rows * cols;
+    g.coords.resize((size_t)vertices * 2);
+    mt19937 rng(seed);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    double cell = 1.0 / max(rows, cols);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            int v = r * cols + c;
+            g.coords[v * 2] = (c + jitter * (2 * unit(rng) - 1)) * cell;
+            g.coords[v * 2 + 1] = (r + jitter * (2 * unit(rng) - 1)) * cell;
+        }
+    }
+    vector<StreamEdge> edges;
+    auto link = [&](int u, int v) { edges.push_back({u, v, g.weight_of(g.distance(u, v))}); };
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            int v = r * cols + c;
+            if (c + 1 < cols && unit(rng) >= removal) link(v, v + 1);
+            if (r + 1 < rows && unit(rng) >= removal) link(v, v + cols);
+            if (r + 1 < rows && c + 1 < cols && unit(rng) < diagonal) {
+                if (rng() & 1) link(v, v + cols + 1);
+                else link(v + 1, v + cols);
+            }
+        }
+    }
+    g.graph = build_csr_from_edges(vertices, false, edges);
+    return g;
+}
+
+/**
+ * A generated graph together with the community every vertex was planted in.
+ */
+struct CommunityGraph {
+    CsrGraph graph; // The undirected graph.
+    vector<int> community; // The planted community of every vertex.
+};
+
+/**
+ * Runs task(t) for every t in [0, tasks) on the given number of threads.
+ * Tasks are handed out in order from a shared counter.
+ *
+ * @param tasks The number of tasks.
+ * @param threads The number of threads, 0 for the hardware concurrency.
+ * @param task The function to call.
+ */
+static void run_generator_tasks(int tasks, int threads, const function<void(int)>& task) {
+    if (threads <= 0) threads = max(1, (int)thread::hardware_concurrency());
+    atomic<int> next(0);
+    auto worker = [&]() {
+        for (int t = next++; t < tasks; t = next++) task(t);
+    };
+    vector<thread> pool;
+    for (int i = 1; i < min(threads, tasks); i++) pool.emplace_back(worker);
+    worker();
+    for (thread& th : pool) th.join();
+}
+
+/**
+ * Returns the random stream of one generator task. Streams depend only on the seed and the task,
+ * so the output is the same for any number of threads.
+ *
+ * @param seed The generator seed.
+ * @param task The task number.
+ * @return The seeded engine.
+ */
+static mt19937_64 generator_stream(unsigned seed, int task) {
+    seed_seq seq{ seed, (unsigned)task, 0x9e3779b9u };
+    return mt19937_64(seq);
+}
+
+/**
+ * Sorts every row of a CSR graph and drops self loops and repeated neighbours, keeping the smallest weight.
+ *
+ * @param csr The graph to clean up in place.
+ */
+static void dedupe_csr(CsrGraph& csr) {
+    vector<pair<int, int>> row;
+    int out = 0;
+    for (int u = 0; u < csr.vertices; u++) {
+        row.clear();
+        for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+            if (csr.targets[e] != u) row.push_back(make_pair(csr.targets[e], csr.weights[e]));
+        }
+        sort(row.begin(), row.end());
+        csr.offsets[u] = out;
+        for (size_t i = 0; i < row.size(); i++) {
+            if (i > 0 && row[i].first == row[i - 1].first) continue;
+            csr.targets[out] = row[i].first;
+            csr.weights[out++] = row[i].second;
+        }
+    }
+    csr.offsets[csr.vertices] = out;
+    csr.targets.resize(out);
+    csr.weights.resize(out);
+}
+
+/**
+ * Generates a Watts-Strogatz small-world graph: a ring where every vertex links to its k / 2 nearest
+ * successors, and each link is rewired to a uniform random vertex with probability beta.
+ * Rewired links that land on an existing one are merged, so the edge count can be slightly below n * k / 2.
+ * Weights are uniform in [1, 100].
+ *
+ * @param vertices The number of vertices.
+ * @param k The ring degree, rounded down to an even number.
+ * @param beta The rewiring probability.
+ * @param seed The random seed.
+ * @param threads The number of threads, 0 for the hardware concurrency.
+ * @return The generated graph.
+ */
+CsrGraph watts_strogatz_graph(int vertices, int k, double beta, unsigned seed, int threads = 0) {
+    TRACE_SCOPE("watts_strogatz_graph");
+    const int chunk = 1 << 14;
+    int tasks = (vertices + chunk - 1) / chunk;
+    vector<vector<StreamEdge>> parts(tasks);
+    run_generator_tasks(tasks, threads, [&](int t) {
+        mt19937_64 rng = generator_stream(seed, t);
+        uniform_real_distribution<double> unit(0.0, 1.0);
+        vector<StreamEdge>& out = parts[t];
+        for (int v = t * chunk; v < min(vertices, (t + 1) * chunk); v++) {
+            for (int j = 1; j <= k / 2; j++) {
+                int u = (v + j) % vertices;
+                if (vertices > 1 && unit(rng) < beta) {
+                    do u = (int)(rng() % vertices); while (u == v);
+                }
+                out.push_back({v, u, (int)(rng() % 100) + 1});
+            }
+        }
+    });
+    vector<StreamEdge> edges;
+    for (const vector<StreamEdge>& part : parts) edges.insert(edges.end(), part.begin(), part.end());
+    CsrGraph csr = build_csr_from_edges(vertices, false, edges);
+    dedupe_csr(csr);
+    return csr;
+}
+
+/**
+ * Generates a stochastic block model graph. Vertices are split into consecutive blocks,
+ * and every pair of vertices in blocks a and b is joined independently with probability p[a][b].
+ * Instead of testing every pair, each task jumps between chosen pairs with geometrically distributed
+ * skips, so the cost is O(n + m). Weights are uniform in [1, 100].
+ *
+ * @param block_sizes The number of vertices in every block.
+ * @param p The symmetric matrix of edge probabilities between blocks.
+ * @param seed The random seed.
+ * @param threads The number of threads, 0 for the hardware concurrency.
+ * @return The graph, with the block of every vertex as its community.
+ */
+CommunityGraph stochastic_block_model(const vector<int>& block_sizes, const vector<vector<double>>& p, unsigned seed, int threads = 0) {
+    TRACE_SCOPE("stochastic_block_model");
+    CommunityGraph result;
+    int blocks = (int)block_sizes.size();
+    vector<int> block_start(blocks + 1, 0);
+    for (int b = 0; b < blocks; b++) block_start[b + 1] = block_start[b] + block_sizes[b];
+    int vertices = block_start[blocks];
+    result.community.resize(vertices);
+    for (int b = 0; b < blocks; b++) {
+        fill(result.community.begin() + block_start[b], result.community.begin() + block_start[b + 1], b);
+    }
+
+    // A task is a range of the row-major pairs of one block pair, sized for about 64K expected edges.
+    // Within a block only pairs with row < column are kept, so every unordered pair is tried once.
+    struct Task {
+        int a, b;
+        long long begin, end;
+    };
+    vector<Task> tasks;
+    for (int a = 0; a < blocks; a++) {
+        for (int b = a; b < blocks; b++) {
+            double prob = p[a][b];
+            long long pairs = (long long)block_sizes[a] * block_sizes[b];
+            if (prob <= 0 || pairs == 0) continue;
+            // Clamped in double: for tiny probabilities the quotient exceeds the range of long long.
+            long long span = max(1LL << 16, (long long)min((double)pairs, (1 << 16) / prob));
+            for (long long begin = 0; begin < pairs; begin += span) tasks.push_back({a, b, begin, min(pairs, begin + span)});
+        }
+    }
+
+    vector<vector<StreamEdge>> parts(tasks.size());
+    run_generator_tasks((int)tasks.size(), threads, [&](int t) {
+        const Task& task = tasks[t];
+        mt19937_64 rng = generator_stream(seed, t);
+        uniform_real_distribution<double> unit(0.0, 1.0);
+        double prob = p[task.a][task.b];
+        double log_miss = prob < 1 ? log1p(-prob) : 0;
+        double length = (double)(task.end - task.begin);
+        int cols = block_sizes[task.b];
+        vector<StreamEdge>& out = parts[t];
+        for (long long pos = task.begin - 1;;) {
+            // A skip past the end of the task is clamped before the cast, it may not fit in long long.
+            pos += prob < 1 ? 1 + (long long)min(length, floor(log(1 - unit(rng)) / log_miss)) : 1;
+            if (pos >= task.end) break;
+            int row = (int)(pos / cols);
+            int col = (int)(pos % cols);
+            if (task.a == task.b && row >= col) continue;
+            out.push_back({block_start[task.a] + row, block_start[task.b] + col, (int)(rng() % 100) + 1});
+        }
+    });
+    vector<StreamEdge> edges;
+    for (const vector<StreamEdge>& part : parts) edges.insert(edges.end(), part.begin(), part.end());
+    result.graph = build_csr_from_edges(vertices, false, edges);
+    return result;
+}
+
+/**
+ * A fixed-capacity concurrent hash map from vertex id to parent, used as the visited set of searches
+ * that touch few vertices of a huge id space. Open addressing with linear probing, keys are claimed with CAS,
+ * so concurrent inserts of the same vertex have exactly one winner. Entries are never removed.
+ */
+class ConcurrentVisitedTable {
+public:
+    /**
+     * Constructor for the ConcurrentVisitedTable class.
+     *
+     * @param expected The number of vertices expected to be inserted. The table is sized for a load factor of at most 1/2
+     * and reports overflow once it is 3/4 full, before probe sequences get long.
+     */
+    explicit ConcurrentVisitedTable(int expected);
+
+    /**
+     * Marks a vertex visited with the given parent.
+     *
+     * @param key The vertex id.
+     * @param parent The parent vertex.
+     * @return True if this call inserted the vertex, false if it was already present or the table has overflowed.
+     */
+    bool insert(uint64_t key, int parent);
+
+    /**
+     * Returns the parent of a visited vertex.
+     *
+     * @param key The vertex id.
+     * @return The parent, -1 if the vertex was not inserted.
+     */
+    int parent(uint64_t key) const;
+
+    /**
+     * Returns whether the table passed its load limit. Once set, every insert fails.
+     *
+     * @return True if the table overflowed.
+     */
+    bool overflowed() const { return overflowed_.load(memory_order_relaxed); }
+
+    /**
+     * Returns the memory used by the slots.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const { return keys_.size() * (sizeof(atomic<uint64_t>) + sizeof(atomic<int>)); }
+
+private:
+    static const uint64_t kEmpty = ~0ULL; // Marks a free slot, not a valid vertex id.
+
+    vector<atomic<uint64_t>> keys_; // The vertex id in every slot.
+    vector<atomic<int>> parents_; // The parent in every slot, -1 until written.
+    uint64_t mask_; // Capacity - 1, the capacity is a power of two.
+    uint64_t limit_; // The number of entries at which the table overflows.
+    atomic<uint64_t> size_; // The number of inserted entries.
+    atomic<bool> overflowed_; // Whether the table passed its load limit.
+
+    /**
+     * Returns the first slot to probe for a key.
+     *
+     * @param key The vertex id.
+     * @return The slot index.
+     */
+    uint64_t home(uint64_t key) const {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key & mask_;
+    }
+};
+
+ConcurrentVisitedTable::ConcurrentVisitedTable(int expected) : size_(0), overflowed_(false) {
+    uint64_t capacity = 16;
+    while (capacity < (uint64_t)max(1, expected) * 2) capacity <<= 1;
+    keys_ = vector<atomic<uint64_t>>(capacity);
+    parents_ = vector<atomic<int>>(capacity);
+    for (uint64_t i = 0; i < capacity; i++) {
+        keys_[i].store(kEmpty, memory_order_relaxed);
+        parents_[i].store(-1, memory_order_relaxed);
+    }
+    mask_ = capacity - 1;
+    limit_ = capacity / 4 * 3;
+}
+
+bool ConcurrentVisitedTable::insert(uint64_t key, int parent) {
+    if (overflowed_.load(memory_order_relaxed)) return false;
+    uint64_t slot = home(key);
+    for (uint64_t probes = 0; probes <= mask_; probes++, slot = (slot + 1) & mask_) {
+        uint64_t current = keys_[slot].load(memory_order_acquire);
+        if (current == key) return false;
+        if (current != kEmpty) continue;
+        uint64_t expected = kEmpty;
+        if (keys_[slot].compare_exchange_strong(expected, key, memory_order_acq_rel)) {
+            parents_[slot].store(parent, memory_order_release);
+            if (size_.fetch_add(1, memory_order_relaxed) + 1 >= limit_) overflowed_.store(true, memory_order_relaxed);
+            return true;
+        }
+        if (expected == key) return false; // Another thread claimed the slot for the same key.
+    }
+    overflowed_.store(true, memory_order_relaxed);
+    return false;
+}
+
+int ConcurrentVisitedTable::parent(uint64_t key) const {
+    uint64_t slot = home(key);
+    for (uint64_t probes = 0; probes <= mask_; probes++, slot = (slot + 1) & mask_) {
+        uint64_t current = keys_[slot].load(memory_order_acquire);
+        if (current == key) return parents_[slot].load(memory_order_acquire);
+        if (current == kEmpty) return -1;
+    }
+    return -1;
+}
+
+/**
+ * A dense concurrent parent array with the same interface as ConcurrentVisitedTable,
+ * for searches expected to touch a large part of the graph.
+ */
+class DenseVisitedArray {
+public:
+    /**
+     * Constructor for the DenseVisitedArray class.
+     *
+     * @param vertices The number of vertices.
+     */
+    explicit DenseVisitedArray(int vertices) : parents_(vertices) {
+        for (atomic<int>& p : parents_) p.store(-1, memory_order_relaxed);
+    }
+
+    /**
+     * Marks a vertex visited with the given parent.
+     *
+     * @param key The vertex.
+     * @param parent The parent vertex.
+     * @return True if this call inserted the vertex.
+     */
+    bool insert(uint64_t key, int parent) {
+        int expected = -1;
+        return parents_[key].load(memory_order_relaxed) == -1 && parents_[key].compare_exchange_strong(expected, parent, memory_order_acq_rel);
+    }
+
+    /**
+     * Returns the parent of a visited vertex.
+     *
+     * @param key The vertex.
+     * @return The parent, -1 if the vertex was not inserted.
+     */
+    int parent(uint64_t key) const { return parents_[key].load(memory_order_acquire); }
+
+    /**
+     * Always false, the array has a slot for every vertex.
+     *
+     * @return False.
+     */
+    bool overflowed() const { return false; }
+
+private:
+    vector<atomic<int>> parents_; // The parent of every vertex, -1 if unvisited.
+};
+
+/**
+ * Runs a level-synchronous parallel BFS from source until target is reached, recording parents in the given visited set.
+ * Every level is split across the pool; a vertex is claimed by the first thread whose insert succeeds.
+ *
+ * @param g The graph or view to search.
+ * @param source The index of the source vertex.
+ * @param target The index of the target vertex.
+ * @param pool The thread pool to run on.
+ * @param visited The visited set, a ConcurrentVisitedTable or DenseVisitedArray.
+ * @return The shortest path, empty if unreachable or if the visited set overflowed.
+ */
+template <typename Visited, typename View>
+vector<int> parallel_bfs_path(const View& g, int source, int target, WorkStealingPool& pool, Visited& visited) {
+    TRACE_SCOPE("parallel_bfs_path");
+    visited.insert(source, source);
+    vector<int> frontier(1, source);
+    atomic<bool> found(source == target);
+    while (!frontier.empty() && !found.load() && !visited.overflowed()) {
+        int parts = pool.size() * 4;
+        int grain = max(64, ((int)frontier.size() + parts - 1) / parts);
+        vector<vector<int>> next((frontier.size() + grain - 1) / grain);
+        pool.parallel_for((int)frontier.size(), grain, [&](int begin, int end) {
+            vector<int>& out = next[begin / grain];
+            // Stop as soon as the target is found or the visited set overflows, not only between levels.
+            for (int i = begin; i < end && !found.load(memory_order_relaxed) && !visited.overflowed(); i++) {
+                int u = frontier[i];
+                g.for_each_neighbor(u, [&](int v, int) {
+                    if (!visited.insert(v, u)) return;
+                    if (v == target) found.store(true, memory_order_relaxed);
+                    out.push_back(v);
+                });
+            }
+        });
+        frontier.clear();
+        for (const vector<int>& part : next) frontier.insert(frontier.end(), part.begin(), part.end());
+    }
+    vector<int> path;
+    if (!found.load() || visited.overflowed()) return path;
+    for (int u = target; u != source; u = visited.parent(u)) path.push_back(u);
+    path.push_back(source);
+    reverse(path.begin(), path.end());
+    return path;
+}
+
+/**
+ * Finds a shortest path with a visited set sized for the search rather than the graph.
+ * The search first runs with a ConcurrentVisitedTable sized for expected_visits, or for about a thousand
+ * vertices when no estimate is given, so memory is proportional to what it touches. If the table fills up,
+ * or would not be small relative to the vertex count, the search runs with a dense array instead.
+ * Without an estimate a search that outgrows the table pays for the aborted attempt, which stops
+ * after about 1500 visits.
+ *
+ * @param g The graph or view to search.
+ * @param source The index of the source vertex.
+ * @param target The index of the target vertex.
+ * @param pool The thread pool to run on.
+ * @param expected_visits The expected number of visited vertices, 0 if unknown.
+ * @return The shortest path, empty if unreachable.
+ */
+template <typename View>
+vector<int> local_bfs_path(const View& g, int source, int target, WorkStealingPool& pool, int expected_visits = 0) {
+    // At load 1/2 a visited vertex costs 24 bytes in the table against 4 bytes per vertex in the array; leave a wide margin.
+    // Without a hint, try about a thousand visits: past that the table costs more per insert than clearing the array saves.
+    int expected = expected_visits > 0 ? expected_visits : 1024;
+    if ((long long)expected * 16 < g.num_vertices()) {
+        ConcurrentVisitedTable table(expected);
+        vector<int> path = parallel_bfs_path(g, source, target, pool, table);
+        if (!table.overflowed()) return path;
+    }
+    DenseVisitedArray dense(g.num_vertices());
+    return parallel_bfs_path(g, source, target, pool, dense);
+}
+
+/**
+ * Statistics of a graph that the query planner bases its choices on. Computed once per graph.
+ */
+struct GraphStats {
+    int vertices = 0; // The number of vertices.
+    long long edges = 0; // The number of stored adjacency entries.
+    bool directed = false; // Whether the graph is directed.
+    double avg_degree = 0; // The mean out-degree.
+    int max_degree = 0; // The largest out-degree.
+    double degree_skew = 0; // max_degree / avg_degree.
+    int components = 0; // The number of (weakly) connected components.
+    vector<int> component; // The component of every vertex.
+    vector<long long> component_edges; // The adjacency entries in every component.
+    vector<int> component_vertices; // The vertices in every component.
+};
+
+/**
+ * Computes the planner statistics of a graph. Components ignore edge direction.
+ *
+ * @param csr The graph.
+ * @return The statistics.
+ */
+GraphStats compute_graph_stats(const CsrGraph& csr) {
+    TRACE_SCOPE("compute_graph_stats");
+    GraphStats s;
+    s.vertices = csr.vertices;
+    s.edges = (long long)csr.targets.size();
+    s.directed = csr.directed;
+    s.avg_degree = csr.vertices > 0 ? (double)s.edges / csr.vertices : 0;
+    for (int u = 0; u < csr.vertices; u++) s.max_degree = max(s.max_degree, csr.degree(u));
+    s.degree_skew = s.avg_degree > 0 ? s.max_degree / s.avg_degree : 0;
+
+    vector<int> parent(csr.vertices);
+    for (int v = 0; v < csr.vertices; v++) parent[v] = v;
+    auto find = [&](int x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    for (int u = 0; u < csr.vertices; u++) {
+        csr.for_each_neighbor(u, [&](int v, int) {
+            int a = find(u), b = find(v);
+            if (a != b) parent[max(a, b)] = min(a, b);
+        });
+    }
+    s.component.assign(csr.vertices, -1);
+    for (int v = 0; v < csr.vertices; v++) {
+        int root = find(v);
+        if (s.component[root] == -1) {
+            s.component[root] = s.components++;
+            s.component_edges.push_back(0);
+            s.component_vertices.push_back(0);
+        }
+        s.component[v] = s.component[root];
+        s.component_edges[s.component[v]] += csr.degree(v);
+        s.component_vertices[s.component[v]]++;
+    }
+    return s;
+}
+
+/**
+ * The engines the query planner can route a query to.
+ */
+enum QueryEngine {
+    kEngineComponents, // Answered from the cached components: the vertices are identical or disconnected.
+    kEngineLandmarks, // LandmarkSketch bounds, finished by a bounded bidirectional BFS.
+    kEngineBidirectional, // Plain bidirectional BFS, undirected graphs only.
+    kEngineSequential, // Single-threaded BFS.
+    kEngineParallel, // Parallel BFS on the thread pool: local_bfs_path for one pair, the Pregel BFS for a single source.
+    kEngineDirectionOptimizing, // Push/pull BFS over the sparse matrix layer.
+    kEngineCount
+};
+
+/**
+ * Returns the display name of an engine.
+ *
+ * @param engine The engine.
+ * @return The name.
+ */
+const char* query_engine_name(QueryEngine engine) {
+    static const char* names[kEngineCount] = { "components", "landmarks", "bidirectional", "sequential", "parallel", "direction_optimizing" };
+    return names[engine];
+}
+
+/**
+ * One routed query, as recorded by the planner.
+ */
+struct PlannerDecision {
+    int source; // The source vertex.
+    int target; // The target vertex, -1 for a single-source query.
+    QueryEngine engine; // The chosen engine.
+    double work; // The work estimate the cost model was evaluated on.
+    double predicted_ns; // The predicted latency.
+    double actual_ns; // The measured latency.
+};
+
+/**
+ * Routes distance queries to the engine the cost model predicts to be fastest.
+ * Every engine is modelled as fixed_ns + ns_per_work * work, where work is estimated from the cached
+ * statistics and the degrees of the query endpoints. Every query is logged with its measured latency,
+ * and refit() re-estimates the coefficients from the log.
+ */
+class QueryPlanner {
+public:
+    /**
+     * Constructor for the QueryPlanner class. Computes the graph statistics.
+     *
+     * @param csr The graph. Must outlive the planner.
+     * @param pool The thread pool for the parallel engines.
+     */
+    QueryPlanner(const CsrGraph& csr, WorkStealingPool& pool);
+
+    /**
+     * Makes a landmark index available to point-to-point queries on undirected graphs.
+     *
+     * @param sketch The index, built for the same graph, or nullptr to detach. Must outlive the planner.
+     */
+    void attach_landmarks(const LandmarkSketch* sketch) { landmarks_ = sketch; }
+
+    /**
+     * Chooses the engine for a point-to-point distance query.
+     *
+     * @param source The source vertex.
+     * @param target The target vertex.
+     * @param work Receives the work estimate for the chosen engine.
+     * @return The engine.
+     */
+    QueryEngine plan_distance(int source, int target, double& work) const;
+
+    /**
+     * Chooses the engine for a single-source distance query.
+     *
+     * @param source The source vertex.
+     * @param work Receives the work estimate for the chosen engine.
+     * @return The engine.
+     */
+    QueryEngine plan_distances(int source, double& work) const;
+
+    /**
+     * Answers a point-to-point hop distance query on the planned engine and logs it.
+     *
+     * @param source The source vertex.
+     * @param target The target vertex.
+     * @return The hop distance, -1 if unreachable.
+     */
+    int distance(int source, int target);
+
+    /**
+     * Answers a single-source hop distance query on the planned engine and logs it.
+     *
+     * @param source The source vertex.
+     * @return The distance to every vertex, -1 for unreachable vertices.
+     */
+    vector<int> distances(int source);
+
+    /**
+     * Re-estimates the fixed and per-work cost of every engine by least squares over the logged queries.
+     * Engines with fewer than two distinct work values in the log keep their coefficients.
+     */
+    void refit();
+
+    /**
+     * Writes the log as CSV: source, target, engine, work, predicted_ns, actual_ns.
+     *
+     * @param path The path of the file to write.
+     * @return True on success.
+     */
+    bool save_log(const string& path) const;
+
+    /**
+     * Returns the logged decisions.
+     *
+     * @return The log, oldest first.
+     */
+    const vector<PlannerDecision>& get_log() const { return log_; }
+
+    /**
+     * Returns the cached graph statistics.
+     *
+     * @return The statistics.
+     */
+    const GraphStats& get_stats() const { return stats_; }
+
+private:
+    const CsrGraph& csr_; // The graph.
+    WorkStealingPool& pool_; // The pool for parallel engines.
+    GraphStats stats_; // The cached statistics.
+    const LandmarkSketch* landmarks_ = nullptr; // The optional landmark index.
+    unique_ptr<SparseMatrix> matrix_; // Built on the first direction-optimizing query.
+    double fixed_ns_[kEngineCount]; // The constant cost of every engine.
+    double ns_per_work_[kEngineCount]; // The cost per unit of estimated work of every engine.
+    vector<PlannerDecision> log_; // Every routed query.
+
+    /**
+     * Returns the predicted latency of an engine.
+     *
+     * @param engine The engine.
+     * @param work The work estimate.
+     * @return The predicted nanoseconds.
+     */
+    double predict(QueryEngine engine, double work) const { return fixed_ns_[engine] + ns_per_work_[engine] * work; }
+
+    /**
+     * Returns the work estimate of the push/pull BFS over a component. Pull steps stop scanning a vertex's
+     * list at the first parent found, which saves most on skewed graphs, where hubs join the frontier
+     * early; the component is divided by sqrt(degree_skew / 4), between 1 and 4.
+     *
+     * @param component The adjacency entries of the component.
+     * @return The work estimate.
+     */
+    double direction_optimizing_work(double component) const {
+        return component / min(4.0, max(1.0, sqrt(stats_.degree_skew / 4)));
+    }
+
+    /**
+     * Returns the sparse matrix of the graph for the push/pull BFS, building it on first use.
+     *
+     * @return The matrix.
+     */
+    const SparseMatrix& matrix() {
+        if (!matrix_) {
+            matrix_.reset(new SparseMatrix());
+            matrix_->build(csr_, true);
+        }
+        return *matrix_;
+    }
+};
+
+QueryPlanner::QueryPlanner(const CsrGraph& csr, WorkStealingPool& pool) : csr_(csr), pool_(pool), stats_(compute_graph_stats(csr)) {
+    // Starting points measured on the benchmark graphs; refit() replaces them with the observed costs.
+    double threads = pool.size();
+    fixed_ns_[kEngineComponents] = 20;
+    ns_per_work_[kEngineComponents] = 0;
+    fixed_ns_[kEngineLandmarks] = 300;
+    ns_per_work_[kEngineLandmarks] = 2;
+    fixed_ns_[kEngineBidirectional] = 200;
+    ns_per_work_[kEngineBidirectional] = 2;
+    fixed_ns_[kEngineSequential] = 200;
+    ns_per_work_[kEngineSequential] = 1.5;
+    fixed_ns_[kEngineParallel] = 20000;
+    ns_per_work_[kEngineParallel] = 4 / threads;
+    fixed_ns_[kEngineDirectionOptimizing] = 50000;
+    ns_per_work_[kEngineDirectionOptimizing] = 3 / threads;
+}
+
+/**
+ * Chooses the engine for a point-to-point query.
+ * Bidirectional search is estimated to touch about twice the square root of the component,
+ * scaled up when an endpoint is a hub; unidirectional search half of the component. The push/pull BFS
+ * has no early exit, so it is charged the whole component, discounted on skewed graphs.
+ */
+QueryEngine QueryPlanner::plan_distance(int source, int target, double& work) const {
+    work = 0;
+    if (source == target || stats_.component[source] != stats_.component[target]) return kEngineComponents;
+    double component = (double)stats_.component_edges[stats_.component[source]];
+    double hub = max(1.0, (csr_.degree(source) + csr_.degree(target)) / (2 * max(1.0, stats_.avg_degree)));
+    double candidates_work[kEngineCount];
+    bool allowed[kEngineCount] = {};
+    candidates_work[kEngineSequential] = component / 2;
+    candidates_work[kEngineParallel] = component / 2;
+    candidates_work[kEngineDirectionOptimizing] = direction_optimizing_work(component);
+    allowed[kEngineSequential] = allowed[kEngineParallel] = allowed[kEngineDirectionOptimizing] = true;
+    if (!stats_.directed) {
+        candidates_work[kEngineBidirectional] = min(component, 2 * sqrt(component) * hub);
+        allowed[kEngineBidirectional] = true;
+        if (landmarks_ != nullptr) {
+            // The bounds usually leave only a short bounded search.
+            candidates_work[kEngineLandmarks] = candidates_work[kEngineBidirectional] / 4;
+            allowed[kEngineLandmarks] = true;
+        }
+    }
+    QueryEngine best = kEngineSequential;
+    for (int e = 0; e < kEngineCount; e++) {
+        if (allowed[e] && predict((QueryEngine)e, candidates_work[e]) < predict(best, candidates_work[best])) best = (QueryEngine)e;
+    }
+    work = candidates_work[best];
+    return best;
+}
+
+/**
+ * Chooses the engine for a single-source query among the sequential, the parallel (Pregel)
+ * and the push/pull BFS. Every engine scans the whole component, the push/pull BFS less on skewed graphs.
+ */
+QueryEngine QueryPlanner::plan_distances(int source, double& work) const {
+    double component = (double)stats_.component_edges[stats_.component[source]];
+    double pull_work = direction_optimizing_work(component);
+    QueryEngine best = kEngineSequential;
+    if (predict(kEngineParallel, component) < predict(best, component)) best = kEngineParallel;
+    if (predict(kEngineDirectionOptimizing, pull_work) < predict(best, component)) best = kEngineDirectionOptimizing;
+    work = best == kEngineDirectionOptimizing ? pull_work : component;
+    return best;
+}
+
+/**
+ * Answers a point-to-point query and logs the decision with its latency.
+ */
+int QueryPlanner::distance(int source, int target) {
+    TRACE_SCOPE("planner/distance");
+    PlannerDecision d;
+    d.source = source;
+    d.target = target;
+    d.engine = plan_distance(source, target, d.work);
+    d.predicted_ns = predict(d.engine, d.work);
+    auto start = chrono::steady_clock::now();
+    int result = -1;
+    switch (d.engine) {
+    case kEngineComponents:
+        result = source == target ? 0 : -1;
+        break;
+    case kEngineLandmarks:
+        result = landmarks_->exact_distance(csr_, source, target);
+        break;
+    case kEngineBidirectional:
+        result = bounded_bidirectional_bfs(csr_, source, target, -1);
+        break;
+    case kEngineParallel:
+        // The search stays inside the component, so a small component gets the sparse visited table.
+        result = (int)local_bfs_path(csr_, source, target, pool_, stats_.component_vertices[stats_.component[source]]).size() - 1;
+        break;
+    case kEngineDirectionOptimizing:
+        result = grb_bfs(matrix(), source, pool_)[target];
+        break;
+    default:
+        result = bfs_distance(csr_, source, target);
+        break;
+    }
+    d.actual_ns = (double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    log_.push_back(d);
+    return result;
+}
+
+/**
+ * Answers a single-source query and logs the decision with its latency.
+ */
+vector<int> QueryPlanner::distances(int source) {
+    TRACE_SCOPE("planner/distances");
+    PlannerDecision d;
+    d.source = source;
+    d.target = -1;
+    d.engine = plan_distances(source, d.work);
+    d.predicted_ns = predict(d.engine, d.work);
+    auto start = chrono::steady_clock::now();
+    vector<int> result;
+    if (d.engine == kEngineDirectionOptimizing) {
+        result = grb_bfs(matrix(), source, pool_);
+    } else if (d.engine == kEngineParallel) {
+        PregelBfs program(source);
+        run_pregel(csr_, program, result, pool_, INT_MAX);
+    } else {
+        result = bfs_distances(csr_, source);
+    }
+    d.actual_ns = (double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    log_.push_back(d);
+    return result;
+}
+
+/**
+ * Fits actual_ns = fixed + slope * work for every engine separately.
+ */
+void QueryPlanner::refit() {
+    for (int e = 0; e < kEngineCount; e++) {
+        double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (const PlannerDecision& d : log_) {
+            if (d.engine != e) continue;
+            n++;
+            sx += d.work;
+            sy += d.actual_ns;
+            sxx += d.work * d.work;
+            sxy += d.work * d.actual_ns;
+        }
+        double denom = n * sxx - sx * sx;
+        if (n < 2 || denom <= 1e-9 * n * sxx) continue;
+        double slope = (n * sxy - sx * sy) / denom;
+        if (slope < 0) continue; // Noise; a cost that falls with work would route every large query here.
+        ns_per_work_[e] = slope;
+        fixed_ns_[e] = max(0.0, (sy - slope * sx) / n);
+    }
+}
+
+/**
+ * Writes the log as CSV.
+ */
+bool QueryPlanner::save_log(const string& path) const {
+    ofstream out(path);
+    out << "source,target,engine,work,predicted_ns,actual_ns\n";
+    for (const PlannerDecision& d : log_) {
+        out << d.source << "," << d.target << "," << query_engine_name(d.engine) << "," << d.work << "," << d.predicted_ns << "," << d.actual_ns << "\n";
+    }
+    return (bool)out;
+}
+
+/**
+ * Computes the strongly connected components of a directed graph with an iterative Tarjan search.
+ * Components are numbered in reverse topological order: an edge between two components
+ * always goes from the higher number to the lower.
+ *
+ * @param csr The directed graph.
+ * @param count Receives the number of components.
+ * @return The component of every vertex.
+ */
+vector<int> strongly_connected_components(const CsrGraph& csr, int& count) {
+    TRACE_SCOPE("strongly_connected_components");
+    int n = csr.vertices;
+    vector<int> component(n, -1);
+    vector<int> index(n, -1);
+    vector<int> low(n, 0);
+    vector<int> stack; // Vertices of components not yet closed.
+    vector<pair<int, int>> call; // The DFS path as (vertex, next edge).
+    int counter = 0;
+    count = 0;
+    for (int root = 0; root < n; root++) {
+        if (index[root] != -1) continue;
+        call.push_back(make_pair(root, csr.offsets[root]));
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        while (!call.empty()) {
+            int u = call.back().first;
+            int& e = call.back().second;
+            if (e < csr.offsets[u + 1]) {
+                int v = csr.targets[e++];
+                if (index[v] == -1) {
+                    index[v] = low[v] = counter++;
+                    stack.push_back(v);
+                    call.push_back(make_pair(v, csr.offsets[v]));
+                } else if (component[v] == -1) {
+                    low[u] = min(low[u], index[v]);
+                }
+                continue;
+            }
+            call.pop_back();
+            if (!call.empty()) low[call.back().first] = min(low[call.back().first], low[u]);
+            if (low[u] == index[u]) {
+                int v;
+                do {
+                    v = stack.back();
+                    stack.pop_back();
+                    component[v] = count;
+                } while (v != u);
+                count++;
+            }
+        }
+    }
+    return component;
+}
+
+/**
+ * Answers directed reachability queries with a pruned 2-hop labeling over the condensation of the graph.
+ * Strongly connected components are collapsed into a DAG, and every DAG node u gets an out-label and
+ * an in-label of hub nodes such that u reaches v exactly when out(u) and in(v) share a hub.
+ * Hubs are processed by decreasing (in + 1) * (out + 1) degree; the BFS from a hub stops at nodes
+ * whose reachability the labels already answer. Queries first try the topological order, which
+ * rejects most unreachable pairs without touching the labels.
+ */
+class ReachabilityIndex {
+public:
+    /**
+     * Builds the index. Hubs are processed in batches of growing size, and the BFSs of one batch run in parallel,
+     * pruning only with the labels of earlier batches.
+     *
+     * @param csr The directed graph to index.
+     * @param threads Number of threads, 0 means hardware concurrency.
+     */
+    void build(const CsrGraph& csr, int threads = 0);
+
+    /**
+     * Returns whether there is a directed path from one vertex to another.
+     *
+     * @param u The index of the source vertex.
+     * @param v The index of the target vertex.
+     * @return True if v is reachable from u. Every vertex reaches itself.
+     */
+    bool reachable(int u, int v) const;
+
+    /**
+     * Returns the strongly connected component of every vertex.
+     *
+     * @return The component numbers, in reverse topological order.
+     */
+    const vector<int>& get_component() const { return component_; }
+
+    /**
+     * Returns the total number of label entries.
+     *
+     * @return The label size.
+     */
+    size_t label_entries() const { return out_labels_.size() + in_labels_.size(); }
+
+    /**
+     * Returns the memory used by the index.
+     *
+     * @return The size in bytes.
+     */
+    size_t bytes() const;
+
+private:
+    vector<int> component_; // The DAG node of every vertex.
+    vector<int> level_; // The longest-path depth of every DAG node from a source.
+    vector<int> out_offsets_; // Out-label offsets per DAG node.
+    vector<int> out_labels_; // Out-label hubs, as ascending hub ranks.
+    vector<int> in_offsets_; // In-label offsets per DAG node.
+    vector<int> in_labels_; // In-label hubs, as ascending hub ranks.
+};
+
+void ReachabilityIndex::build(const CsrGraph& csr, int threads) {
+    TRACE_SCOPE("ReachabilityIndex::build");
+    int nodes = 0;
+    component_ = strongly_connected_components(csr, nodes);
+    vector<StreamEdge> dag_edges;
+    for (int u = 0; u < csr.vertices; u++) {
+        csr.for_each_neighbor(u, [&](int v, int) {
+            if (component_[u] != component_[v]) dag_edges.push_back({component_[u], component_[v], 1});
+        });
+    }
+    CsrGraph dag = build_csr_from_edges(nodes, true, dag_edges);
+    dedupe_csr(dag);
+    for (StreamEdge& e : dag_edges) swap(e.src, e.dst);
+    CsrGraph reverse_dag = build_csr_from_edges(nodes, true, dag_edges);
+    dedupe_csr(reverse_dag);
+    dag_edges = vector<StreamEdge>();
+
+    // Nodes are numbered in reverse topological order, so sources come last.
+    level_.assign(nodes, 0);
+    for (int c = nodes - 1; c >= 0; c--) {
+        dag.for_each_neighbor(c, [&](int d, int) { level_[d] = max(level_[d], level_[c] + 1); });
+    }
+
+    vector<int> order(nodes);
+    for (int c = 0; c < nodes; c++) order[c] = c;
+    sort(order.begin(), order.end(), [&](int a, int b) {
+        long long wa = (long long)(dag.degree(a) + 1) * (reverse_dag.degree(a) + 1);
+        long long wb = (long long)(dag.degree(b) + 1) * (reverse_dag.degree(b) + 1);
+        return wa != wb ? wa > wb : a < b;
+    });
+
+    vector<vector<int>> out_label(nodes), in_label(nodes);
+    auto covered = [&](const vector<int>& a, const vector<int>& b) {
+        size_t i = 0, j = 0;
+        while (i < a.size() && j < b.size()) {
+            if (a[i] == b[j]) return true;
+            if (a[i] < b[j]) i++;
+            else j++;
+        }
+        return false;
+    };
+
+    if (threads <= 0) threads = max(1, (int)thread::hardware_concurrency());
+    vector<vector<int>> stamp(threads, vector<int>(nodes, -1));
+    vector<vector<int>> queue(threads);
+    // found[i][0] lists the nodes hub i of the batch reaches, found[i][1] the nodes reaching it.
+    vector<array<vector<int>, 2>> found;
+    int batch = 1;
+    for (int begin = 0; begin < nodes; begin += batch, batch = min(batch * 2, 64 * threads)) {
+        int end = min(nodes, begin + batch);
+        found.assign(end - begin, array<vector<int>, 2>());
+        auto run = [&](int t) {
+            vector<int>& seen = stamp[t];
+            vector<int>& q = queue[t];
+            for (int rank = begin + t; rank < end; rank += threads) {
+                int hub = order[rank];
+                for (int side = 0; side < 2; side++) {
+                    const CsrGraph& g = side == 0 ? dag : reverse_dag;
+                    vector<int>& out = found[rank - begin][side];
+                    int mark = rank * 2 + side;
+                    q.assign(1, hub);
+                    seen[hub] = mark;
+                    for (size_t head = 0; head < q.size(); head++) {
+                        int w = q[head];
+                        if (side == 0 ? covered(out_label[hub], in_label[w]) : covered(out_label[w], in_label[hub])) continue;
+                        out.push_back(w);
+                        g.for_each_neighbor(w, [&](int x, int) {
+                            if (seen[x] != mark) {
+                                seen[x] = mark;
+                                q.push_back(x);
+                            }
+                        });
+                    }
+                }
+            }
+        };
+        vector<thread> pool;
+        for (int t = 1; t < min(threads, end - begin); t++) pool.emplace_back(run, t);
+        run(0);
+        for (thread& th : pool) th.join();
+        // Appending in rank order keeps every label sorted.
+        for (int rank = begin; rank < end; rank++) {
+            for (int w : found[rank - begin][0]) in_label[w].push_back(rank);
+            for (int w : found[rank - begin][1]) out_label[w].push_back(rank);
+        }
+    }
+
+    auto flatten = [&](vector<vector<int>>& labels, vector<int>& offsets, vector<int>& flat) {
+        offsets.assign(nodes + 1, 0);
+        for (int c = 0; c < nodes; c++) offsets[c + 1] = offsets[c] + (int)labels[c].size();
+        flat.clear();
+        flat.reserve(offsets[nodes]);
+        for (vector<int>& l : labels) {
+            flat.insert(flat.end(), l.begin(), l.end());
+            vector<int>().swap(l);
+        }
+    };
+    flatten(out_label, out_offsets_, out_labels_);
+    flatten(in_label, in_offsets_, in_labels_);
+}
+
+bool ReachabilityIndex::reachable(int u, int v) const {
+    int a = component_[u], b = component_[v];
+    if (a == b) return true;
+    if (a < b || level_[a] >= level_[b]) return false;
+    const int* i = out_labels_.data() + out_offsets_[a];
+    const int* i_end = out_labels_.data() + out_offsets_[a + 1];
+    const int* j = in_labels_.data() + in_offsets_[b];
+    const int* j_end = in_labels_.data() + in_offsets_[b + 1];
+    while (i < i_end && j < j_end) {
+        if (*i == *j) return true;
+        if (*i < *j) i++;
+        else j++;
+    }
+    return false;
+}
+
+size_t ReachabilityIndex::bytes() const {
+    return (component_.size() + level_.size() + out_offsets_.size() + out_labels_.size() + in_offsets_.size() + in_labels_.size()) * sizeof(int);
+}
+
+/**
+ * Computes the dominator tree of a flow graph with the semi-NCA algorithm.
+ * A vertex d dominates v if every path from the root to v passes through d; the immediate dominator
+ * is the closest strict dominator. The DFS, the path compression of eval and the final NCA walk are all
+ * iterative, so deep graphs do not overflow the call stack. Runs in O(m log n).
+ *
+ * @param csr The graph. Undirected graphs are treated as having both edge directions.
+ * @param root The entry vertex.
+ * @return The immediate dominator of every vertex; root maps to itself and unreachable vertices to -1.
+ */
+vector<int> dominator_tree(const CsrGraph& csr, int root) {
+    TRACE_SCOPE("dominator_tree");
+    int n = csr.vertices;
+    vector<int> number(n, -1); // Preorder number of every vertex, -1 if unreachable.
+    vector<int> vertex; // The vertex with every preorder number.
+    vector<int> parent; // DFS tree parent of every number.
+    vertex.reserve(n);
+    parent.reserve(n);
+
+    vector<pair<int, int>> stack; // The DFS path as (vertex, next edge).
+    number[root] = 0;
+    vertex.push_back(root);
+    parent.push_back(-1);
+    stack.push_back(make_pair(root, csr.offsets[root]));
+    while (!stack.empty()) {
+        int u = stack.back().first;
+        int& e = stack.back().second;
+        if (e == csr.offsets[u + 1]) {
+            stack.pop_back();
+            continue;
+        }
+        int v = csr.targets[e++];
+        if (number[v] != -1) continue;
+        number[v] = (int)vertex.size();
+        vertex.push_back(v);
+        parent.push_back(number[u]);
+        stack.push_back(make_pair(v, csr.offsets[v]));
+    }
+    int reached = (int)vertex.size();
+
+    CsrGraph reverse_graph;
+    if (csr.directed) {
+        vector<StreamEdge> reversed;
+        for (int u = 0; u < n; u++) {
+            if (number[u] == -1) continue;
+            csr.for_each_neighbor(u, [&](int v, int) { reversed.push_back({v, u, 1}); });
+        }
+        reverse_graph = build_csr_from_edges(n, true, reversed);
+    }
+    const CsrGraph& predecessors = csr.directed ? reverse_graph : csr;
+
+    // Everything below works on preorder numbers. link is the ancestor in the path-compressed forest of
+    // processed vertices, label the vertex of minimum semidominator on the compressed path.
+    vector<int> semi(reached), label(reached), link(parent), idom(parent);
+    for (int i = 0; i < reached; i++) semi[i] = label[i] = i;
+    vector<int> path;
+    auto eval = [&](int v, int last_linked) {
+        if (link[v] < last_linked) return label[v];
+        path.clear();
+        do {
+            path.push_back(v);
+            v = link[v];
+        } while (link[v] >= last_linked);
+        int p = v;
+        int p_label = label[p];
+        while (!path.empty()) {
+            v = path.back();
+            path.pop_back();
+            link[v] = link[p];
+            if (semi[p_label] < semi[label[v]]) label[v] = p_label;
+            else p_label = label[v];
+            p = v;
+        }
+        return label[v];
+    };
+    for (int w = reached - 1; w >= 1; w--) {
+        semi[w] = parent[w];
+        predecessors.for_each_neighbor(vertex[w], [&](int u, int) {
+            if (number[u] == -1) return;
+            semi[w] = min(semi[w], semi[eval(number[u], w + 1)]);
+        });
+    }
+    for (int w = 1; w < reached; w++) {
+        int candidate = idom[w];
+        while (candidate > semi[w]) candidate = idom[candidate];
+        idom[w] = candidate;
+    }
+
+    vector<int> result(n, -1);
+    result[root] = root;
+    for (int w = 1; w < reached; w++) result[vertex[w]] = vertex[idom[w]];
+    return result;
+}
+
+/**
+ * The outcome of the degree-parity test for an Euler trail.
+ */
+struct EulerCheck {
+    bool exists = false; // Whether the degrees allow a trail through every edge.
+    bool circuit = false; // Whether the trail can be closed.
+    int start = -1; // The vertex the trail has to start at, -1 if the graph has no edges.
+};
+
+/**
+ * Tests the degree condition for an Euler trail. Directed graphs need in = out everywhere for a circuit,
+ * or one vertex with one extra out-edge and one with one extra in-edge for a path.
+ * Undirected graphs need zero or two vertices of odd degree. Connectivity is not checked here;
+ * euler_path detects it when the trail comes up short.
+ *
+ * @param csr The graph.
+ * @return The result of the test.
+ */
+EulerCheck check_euler(const CsrGraph& csr) {
+    EulerCheck check;
+    int n = csr.vertices;
+    vector<int> balance(n, 0); // Out-degree minus in-degree, or the degree for undirected graphs.
+    for (int u = 0; u < n; u++) {
+        balance[u] += csr.degree(u);
+        if (csr.directed) csr.for_each_neighbor(u, [&](int v, int) { balance[v]--; });
+    }
+    int first_edge = -1, plus = 0, minus = 0, start = -1;
+    for (int u = 0; u < n; u++) {
+        if (first_edge == -1 && csr.degree(u) > 0) first_edge = u;
+        int b = balance[u];
+        if (csr.directed) {
+            if (b == 1) {
+                plus++;
+                start = u;
+            } else if (b == -1) {
+                minus++;
+            } else if (b != 0) {
+                return check;
+            }
+        } else if (b % 2 != 0) {
+            if (start == -1) start = u;
+            plus++;
+        }
+    }
+    if (first_edge == -1) {
+        check.exists = check.circuit = true;
+        return check;
+    }
+    if (plus == 0 && minus == 0) {
+        check.exists = check.circuit = true;
+        check.start = first_edge;
+    } else if (csr.directed ? plus == 1 && minus == 1 : plus == 2) {
+        check.exists = true;
+        check.start = start;
+    }
+    return check;
+}
+
+/**
+ * Finds an Euler trail, a walk that uses every edge exactly once, with an iterative Hierholzer search.
+ * Every vertex keeps a cursor into its CSR row and used edges are marked in a bitset, so nothing is erased
+ * and the search is linear in the number of edges. For undirected graphs both copies of an edge are paired
+ * up first with a linear bucket pass, so using one marks the other.
+ *
+ * @param csr The graph.
+ * @return The vertices of the trail, a circuit whenever one exists; empty if there is no trail or no edge.
+ */
+vector<int> euler_path(const CsrGraph& csr) {
+    TRACE_SCOPE("euler_path");
+    vector<int> path;
+    EulerCheck check = check_euler(csr);
+    if (!check.exists || check.start == -1) return path;
+    int n = csr.vertices;
+    int m = (int)csr.targets.size();
+
+    vector<int> twin;
+    if (!csr.directed) {
+        // Bucket the entries u->v with u < v by v, in increasing u, then match them against v's entries v->u.
+        twin.assign(m, -1);
+        vector<int> lower_offsets(n + 1, 0);
+        for (int u = 0; u < n; u++) {
+            csr.for_each_neighbor(u, [&](int v, int) { if (u < v) lower_offsets[v + 1]++; });
+        }
+        for (int v = 0; v < n; v++) lower_offsets[v + 1] += lower_offsets[v];
+        vector<int> lower_entry(lower_offsets[n]), lower_source(lower_offsets[n]);
+        vector<int> cursor(lower_offsets.begin(), lower_offsets.end() - 1);
+        for (int u = 0; u < n; u++) {
+            for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; e++) {
+                int v = csr.targets[e];
+                if (u >= v) continue;
+                lower_entry[cursor[v]] = e;
+                lower_source[cursor[v]++] = u;
+            }
+        }
+        vector<int> first(n, 0); // Next unmatched bucket position per source, valid within one v.
+        for (int v = 0; v < n; v++) {
+            for (int i = lower_offsets[v + 1] - 1; i >= lower_offsets[v]; i--) first[lower_source[i]] = i;
+            int self = -1;
+            for (int e = csr.offsets[v]; e < csr.offsets[v + 1]; e++) {
+                int w = csr.targets[e];
+                if (w > v) continue;
+                int other;
+                if (w < v) {
+                    other = lower_entry[first[w]++];
+                } else if (self == -1) {
+                    // A self loop is stored twice in its own row; pair consecutive copies.
+                    self = e;
+                    continue;
+                } else {
+                    other = self;
+                    self = -1;
+                }
+                twin[e] = other;
+                twin[other] = e;
+            }
+        }
+    }
+
+    vector<uint64_t> used(((size_t)m + 63) / 64, 0);
+    vector<int> cursor(csr.offsets.begin(), csr.offsets.end() - 1);
+    vector<int> stack(1, check.start);
+    size_t trail_edges = csr.directed ? (size_t)m : (size_t)m / 2;
+    path.reserve(trail_edges + 1);
+    while (!stack.empty()) {
+        int u = stack.back();
+        int& e = cursor[u];
+        while (e < csr.offsets[u + 1] && (used[e >> 6] >> (e & 63) & 1)) e++;
+        if (e == csr.offsets[u + 1]) {
+            path.push_back(u);
+            stack.pop_back();
+            continue;
+        }
+        used[e >> 6] |= 1ULL << (e & 63);
+        if (!csr.directed) used[twin[e] >> 6] |= 1ULL << (twin[e] & 63);
+        stack.push_back(csr.targets[e++]);
+    }
+    // Edges left over lie in another component.
+    if (path.size() != trail_edges + 1) return vector<int>();
+    reverse(path.begin(), path.end());
+    return path;
+}
+
+/**
+ * Keeps a value alive so the compiler can not optimize away the computation that produced it.
+ * @param value The value to keep.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(_MSC_VER)
+    static const void* volatile sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+/**
+ * The loop state handed to a benchmark function. Only the time spent inside the
+ * while (state.keep_running()) loop is measured, so setup before the loop is free.
+ */
+class BenchState {
+public:
+    /**
+     * Constructor for the BenchState class.
+     *
+     * @param iterations The number of loop iterations to run.
+     */
+    BenchState(long long iterations) : iterations_(iterations), done_(0), seconds_(0) {}
+
+    /**
+     * Advances the benchmark loop.
+     *
+     * @return True while iterations remain.
+     */
+    bool keep_running() {
+        if (done_ == 0) start_ = chrono::steady_clock::now();
+        if (done_ == iterations_) {
+            seconds_ = chrono::duration<double>(chrono::steady_clock::now() - start_).count();
+            return false;
+        }
+        done_++;
+        return true;
+    }
+
+    /**
+     * Returns the number of iterations the loop runs.
+     *
+     * @return The iteration count.
+     */
+    long long iterations() const { return iterations_; }
+
+    /**
+     * Returns the time spent in the loop.
+     *
+     * @return The elapsed time in seconds.
+     */
+    double seconds() const { return seconds_; }
+
+private:
+    long long iterations_; // The number of iterations to run.
+    long long done_; // The number of iterations started.
+    double seconds_; // The measured loop time.
+    chrono::steady_clock::time_point start_; // When the first iteration started.
+};
+
+/**
+ * The statistics of one benchmark.
+ */
+struct BenchmarkResult {
+    string name; // The benchmark name.
+    long long iterations = 0; // Iterations per repetition.
+    vector<double> samples; // Nanoseconds per iteration of every repetition.
+    double mean = 0; // Mean of the samples.
+    double median = 0; // Median of the samples.
+    double stddev = 0; // Sample standard deviation.
+    double min = 0; // Fastest repetition.
+};
+
+/**
+ * A small Google-Benchmark-style runner: every registered function is calibrated to run for
+ * at least a minimum time, then repeated to collect per-iteration timing statistics.
+ */
+class BenchmarkRunner {
+public:
+    /**
+     * Registers a benchmark.
+     *
+     * @param name The benchmark name, conventionally "kernel/variant/size".
+     * @param fn The benchmark body, which must loop on state.keep_running().
+     */
+    void add(const string& name, function<void(BenchState&)> fn);
+
+    /**
+     * Runs every benchmark whose name contains the filter.
+     *
+     * @param filter Substring selecting benchmarks, empty for all.
+     * @param min_time Minimum time of one repetition in seconds. Default is 0.1.
+     * @param repetitions Number of measured repetitions. Default is 5.
+     * @return The statistics of every benchmark run.
+     */
+    vector<BenchmarkResult> run(const string& filter, double min_time = 0.1, int repetitions = 5) const;
+
+    /**
+     * Prints results as a table.
+     *
+     * @param results The results to print.
+     */
+    static void print(const vector<BenchmarkResult>& results);
+
+private:
+    vector<pair<string, function<void(BenchState&)>>> benchmarks_; // The registered benchmarks.
+};
+
+/**
+ * Registers a benchmark.
+ * @param name The benchmark name.
+ * @param fn The benchmark body.
+ */
+void BenchmarkRunner::add(const string& name, function<void(BenchState&)> fn) {
+    benchmarks_.push_back(make_pair(name, fn));
+}
+
+/**
+ * Runs every benchmark whose name contains the filter.
+ * @param filter Substring selecting benchmarks.
+ * @param min_time Minimum time of one repetition in seconds.
+ * @param repetitions Number of measured repetitions.
+ * @return The statistics of every benchmark run.
+ */
+vector<BenchmarkResult> BenchmarkRunner::run(const string& filter, double min_time, int repetitions) const {
+    vector<BenchmarkResult> results;
+    for (const pair<string, function<void(BenchState&)>>& bench : benchmarks_) {
+        if (!filter.empty() && bench.first.find(filter) == string::npos) continue;
+
+        // Grow the iteration count until one run is long enough to time reliably.
+        long long iterations = 1;
+        for (;;) {
+            BenchState state(iterations);
+            bench.second(state);
+            if (state.seconds() >= min_time || iterations >= 1000000000LL) break;
+            double per_iteration = max(state.seconds() / iterations, 1e-9);
+            long long next = (long long)(min_time * 1.2 / per_iteration);
+            iterations = max(iterations * 2, min(next, iterations * 100));
+        }
+
+        BenchmarkResult result;
+        result.name = bench.first;
+        result.iterations = iterations;
+        for (int r = 0; r < repetitions; r++) {
+            BenchState state(iterations);
+            bench.second(state);
+            result.samples.push_back(state.seconds() * 1e9 / iterations);
+        }
+        vector<double> sorted = result.samples;
+        sort(sorted.begin(), sorted.end());
+        size_t n = sorted.size();
+        result.min = sorted[0];
+        result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+        for (double s : sorted) result.mean += s / n;
+        for (double s : sorted) result.stddev += (s - result.mean) * (s - result.mean);
+        result.stddev = n > 1 ? sqrt(result.stddev / (n - 1)) : 0;
+        results.push_back(result);
+        print(vector<BenchmarkResult>(1, result));
+    }
+    return results;
+}
+
+/**
+ * Prints results as a table.
+ * @param results The results to print.
+ */
+void BenchmarkRunner::print(const vector<BenchmarkResult>& results) {
+    for (const BenchmarkResult& r : results) {
+        cout << r.name << string(r.name.size() < 40 ? 40 - r.name.size() : 1, ' ')
+            << "mean " << r.mean << " ns  median " << r.median << " ns  stddev " << r.stddev
+            << " ns  iterations " << r.iterations << endl;
+    }
+}
+
+/**
+ * Generates a reproducible random graph for benchmarks, independent of the global rand() state.
+ *
+ * @param vertices The number of vertices.
+ * @param edges The number of distinct edges.
+ * @param directed Whether the graph is directed.
+ * @param seed The random seed.
+ * @return The generated graph.
+ */
+Graph make_bench_graph(int vertices, int edges, bool directed, unsigned seed) {
+    Graph g(vertices, directed);
+    mt19937 rng(seed);
+    for (int added = 0; added < edges;) {
+        int u = rng() % vertices;
+        int v = rng() % vertices;
+        if (u == v || g.has_edge(u, v)) continue;
+        g.add_edge(u, v, rng() % 100 + 1);
+        added++;
+    }
+    return g;
+}
+
+/**
+ * A fixed-seed benchmark input shared by the benchmarks of one size.
+ * The graph and its CSR are built on first use, so filtered-out sizes cost nothing.
+ */
+class BenchFixture {
+public:
+    /**
+     * Constructor for the BenchFixture class.
+     *
+     * @param vertices The number of vertices.
+     * @param edges The number of edges.
+     * @param seed The random seed.
+     */
+    BenchFixture(int vertices, int edges, unsigned seed) : vertices_(vertices), edges_(edges), seed_(seed) {}
+
+    /**
+     * Returns the undirected fixture graph.
+     *
+     * @return The graph.
+     */
+    Graph& get_graph() {
+        if (!graph_) graph_.reset(new Graph(make_bench_graph(vertices_, edges_, false, seed_)));
+        return *graph_;
+    }
+
+    /**
+     * Returns the CSR of the fixture graph.
+     *
+     * @return The CSR.
+     */
+    const CsrGraph& get_csr() {
+        if (csr_.offsets.empty()) csr_ = build_csr(get_graph());
+        return csr_;
+    }
+
+private:
+    int vertices_; // The number of vertices.
+    int edges_; // The number of edges.
+    unsigned seed_; // The random seed.
+    unique_ptr<Graph> graph_; // The graph, built on first use.
+    CsrGraph csr_; // The CSR, built on first use.
+};
+
+/**
+ * Registers the kernel-level benchmarks of every representation and algorithm.
+ *
+ * @param runner The runner to register the benchmarks with.
+ */
+void register_benchmarks(BenchmarkRunner& runner) {
+    const unsigned seed = 12345;
+    shared_ptr<WorkStealingPool> pool = make_shared<WorkStealingPool>();
+    for (int n : { 1000, 4000 }) {
+        string size = "/" + to_string(n);
+        int m = n * 8;
+        shared_ptr<BenchFixture> fixture = make_shared<BenchFixture>(n, m, seed);
+        auto csr_fixture = [fixture]() -> const CsrGraph& { return fixture->get_csr(); };
+
+        runner.add("neighbors/adj_matrix" + size, [fixture](BenchState& state) {
+            vector<vector<int>> matrix = fixture->get_graph().get_adj_matrix();
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (size_t u = 0; u < matrix.size(); u++) {
+                    for (size_t v = 0; v < matrix[u].size(); v++) if (matrix[u][v] != 0) sum += v;
+                }
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("neighbors/adj_list" + size, [fixture](BenchState& state) {
+            vector<vector<pair<int, int>>> list = fixture->get_graph().get_adj_list();
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (const vector<pair<int, int>>& row : list) {
+                    for (const pair<int, int>& e : row) sum += e.first;
+                }
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("neighbors/csr" + size, [csr_fixture](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (int u = 0; u < g.vertices; u++) g.for_each_neighbor(u, [&](int v, int) { sum += v; });
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("neighbors/symmetric" + size, [fixture](BenchState& state) {
+            SymmetricGraph g;
+            g.build(fixture->get_graph(), false);
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (int u = 0; u < g.num_vertices(); u++) g.for_each_neighbor(u, [&](int v, int) { sum += v; });
+                do_not_optimize(sum);
+            }
+        });
+        // The weighted scans also read every weight, which the symmetric lists store once per edge.
+        runner.add("neighbors/csr_weighted" + size, [csr_fixture](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (int u = 0; u < g.vertices; u++) g.for_each_neighbor(u, [&](int v, int w) { sum += v + w; });
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("neighbors/symmetric_weighted" + size, [fixture](BenchState& state) {
+            SymmetricGraph g;
+            g.build(fixture->get_graph(), false);
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (int u = 0; u < g.num_vertices(); u++) g.for_each_neighbor(u, [&](int v, int w) { sum += v + w; });
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("neighbors/succinct" + size, [csr_fixture](BenchState& state) {
+            SuccinctGraph g;
+            g.build(csr_fixture());
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (int u = 0; u < g.num_vertices(); u++) g.for_each_neighbor(u, [&](int v, int) { sum += v; });
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("neighbors/compressed_random" + size, [csr_fixture](BenchState& state) {
+            CompressedGraph g;
+            g.build(csr_fixture());
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (int u = 0; u < g.num_vertices(); u++) g.for_each_neighbor(u, [&](int v, int) { sum += v; });
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("neighbors/compressed_scan" + size, [csr_fixture](BenchState& state) {
+            CompressedGraph g;
+            g.build(csr_fixture());
+            while (state.keep_running()) {
+                long long sum = 0;
+                g.scan([&](int, const vector<int>& list) { for (int v : list) sum += v; });
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("neighbors/k2tree" + size, [csr_fixture](BenchState& state) {
+            K2Tree g;
+            g.build(csr_fixture());
+            while (state.keep_running()) {
+                long long sum = 0;
+                for (int u = 0; u < g.num_vertices(); u++) g.for_each_neighbor(u, [&](int v, int) { sum += v; });
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("has_edge/edge_index" + size, [csr_fixture, n, seed](BenchState& state) {
+            EdgeIndex index;
+            index.build(csr_fixture());
+            mt19937 rng(seed);
+            while (state.keep_running()) {
+                int found = 0;
+                for (int i = 0; i < 1024; i++) found += index.has_edge(rng() % n, rng() % n);
+                do_not_optimize(found);
+            }
+        });
+        runner.add("graph/add_edge" + size, [n, m, seed](BenchState& state) {
+            mt19937 rng(seed);
+            vector<pair<int, int>> edges(m);
+            for (pair<int, int>& e : edges) e = make_pair((int)(rng() % n), (int)(rng() % n));
+            while (state.keep_running()) {
+                Graph g(n);
+                for (const pair<int, int>& e : edges) g.add_edge(e.first, e.second);
+                do_not_optimize(g);
+            }
+        });
+        runner.add("graph/build_csr" + size, [fixture](BenchState& state) {
+            Graph& g = fixture->get_graph();
+            while (state.keep_running()) {
+                CsrGraph csr = build_csr(g);
+                do_not_optimize(csr);
+            }
+        });
+        runner.add("pregel/bfs" + size, [csr_fixture, pool](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            PregelBfs program(0);
+            vector<int> level;
+            while (state.keep_running()) {
+                run_pregel(g, program, level, *pool, INT_MAX);
+                do_not_optimize(level);
+            }
+        });
+        runner.add("graphblas/bfs" + size, [csr_fixture, pool](BenchState& state) {
+            SparseMatrix a;
+            a.build(csr_fixture());
+            while (state.keep_running()) {
+                vector<int> level = grb_bfs(a, 0, *pool);
+                do_not_optimize(level);
+            }
+        });
+        runner.add("edge_centric/bfs" + size, [csr_fixture](BenchState& state) {
+            EdgePartitions edges;
+            edges.build(csr_fixture());
+            while (state.keep_running()) {
+                EdgeCentricBfs program(edges.get_vertices(), 0);
+                run_edge_centric(edges, program, INT_MAX);
+                do_not_optimize(program.level);
+            }
+        });
+        runner.add("pregel/components" + size, [csr_fixture, pool](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            PregelComponents program;
+            vector<int> label;
+            while (state.keep_running()) {
+                run_pregel(g, program, label, *pool, INT_MAX);
+                do_not_optimize(label);
+            }
+        });
+        runner.add("edge_centric/components" + size, [csr_fixture](BenchState& state) {
+            EdgePartitions edges;
+            edges.build(csr_fixture());
+            while (state.keep_running()) {
+                EdgeCentricComponents program(edges.get_vertices());
+                run_edge_centric(edges, program, INT_MAX);
+                do_not_optimize(program.label);
+            }
+        });
+        runner.add("generate/geometric" + size, [n](BenchState& state) {
+            while (state.keep_running()) {
+                SpatialGraph g = random_geometric_graph(n, 2, sqrt(16.0 / (3.14159265 * n)), 1);
+                do_not_optimize(g.graph.targets);
+            }
+        });
+        runner.add("stream/components" + size, [csr_fixture](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            while (state.keep_running()) {
+                RandomEdgeStream stream(g.vertices, g.targets.size() / 2, 1);
+                StreamSummary summary = summarize_edge_stream(stream, g.vertices);
+                do_not_optimize(summary);
+            }
+        });
+        runner.add("pregel/pagerank" + size, [csr_fixture, pool](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            PregelPageRank program(g.vertices, 10);
+            vector<double> rank;
+            while (state.keep_running()) {
+                run_pregel(g, program, rank, *pool, INT_MAX);
+                do_not_optimize(rank);
+            }
+        });
+        runner.add("edge_centric/pagerank" + size, [csr_fixture](BenchState& state) {
+            EdgePartitions edges;
+            edges.build(csr_fixture());
+            while (state.keep_running()) {
+                EdgeCentricPageRank program(edges);
+                run_edge_centric(edges, program, 10);
+                do_not_optimize(program.rank);
+            }
+        });
+        runner.add("queue/std_queue" + size, [n](BenchState& state) {
+            while (state.keep_running()) {
+                queue<int> q;
+                long long sum = 0;
+                for (int i = 0; i < n; i++) q.push(i);
+                while (!q.empty()) {
+                    sum += q.front();
+                    q.pop();
+                }
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("queue/vector_queue" + size, [n](BenchState& state) {
+            vector<int> q;
+            while (state.keep_running()) {
+                q.clear();
+                long long sum = 0;
+                for (int i = 0; i < n; i++) q.push_back(i);
+                for (size_t head = 0; head < q.size(); head++) sum += q[head];
+                do_not_optimize(sum);
+            }
+        });
+        runner.add("path/reconstruct" + size, [csr_fixture](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            vector<int> parent(g.vertices, -1);
+            vector<int> order(1, 0);
+            parent[0] = 0;
+            for (size_t head = 0; head < order.size(); head++) {
+                g.for_each_neighbor(order[head], [&](int v, int) {
+                    if (parent[v] == -1) {
+                        parent[v] = order[head];
+                        order.push_back(v);
+                    }
+                });
+            }
+            int target = order.back();
+            while (state.keep_running()) {
+                vector<int> path;
+                for (int u = target; u != 0; u = parent[u]) path.push_back(u);
+                path.push_back(0);
+                reverse(path.begin(), path.end());
+                do_not_optimize(path);
+            }
+        });
+        runner.add("bfs/csr_template" + size, [csr_fixture](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            while (state.keep_running()) {
+                vector<int> dist = bfs_distances(g, 0);
+                do_not_optimize(dist);
+            }
+        });
+        runner.add("bfs/levels_uint8" + size, [csr_fixture](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            vector<uint8_t> levels;
+            while (state.keep_running()) {
+                bfs_levels(g, 0, levels);
+                do_not_optimize(levels);
+            }
+        });
+        runner.add("bfs/distance_only" + size, [csr_fixture](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            int target = g.vertices - 1;
+            while (state.keep_running()) {
+                int dist = bfs_distance(g, 0, target);
+                do_not_optimize(dist);
+            }
+        });
+        runner.add("bfs/planner" + size, [csr_fixture, pool](BenchState& state) {
+            QueryPlanner planner(csr_fixture(), *pool);
+            int n = planner.get_stats().vertices;
+            int target = 0;
+            while (state.keep_running()) {
+                target = (target + 7919) % n;
+                int dist = planner.distance(0, target);
+                do_not_optimize(dist);
+            }
+        });
+        runner.add("reach/two_hop" + size, [n](BenchState& state) {
+            Graph g = make_bench_graph(n, n * 2, true, seed);
+            CsrGraph csr = build_csr(g);
+            ReachabilityIndex index;
+            index.build(csr);
+            int u = 0, v = 0;
+            while (state.keep_running()) {
+                u = (u + 7919) % n;
+                v = (v + 104729) % n;
+                bool reachable = index.reachable(u, v);
+                do_not_optimize(reachable);
+            }
+        });
+        runner.add("graph/euler_path" + size, [n](BenchState& state) {
+            // A union of closed walks is Eulerian; the first one visits every vertex, which keeps it connected.
+            mt19937 rng(seed);
+            vector<int> order(n);
+            for (int v = 0; v < n; v++) order[v] = v;
+            shuffle(order.begin(), order.end(), rng);
+            vector<StreamEdge> edges;
+            for (int i = 0; i < n; i++) edges.push_back({order[i], order[(i + 1) % n], 1});
+            for (int walk = 0; walk < 8; walk++) {
+                int start = rng() % n, u = start;
+                for (int step = 0; step < n / 2; step++) {
+                    int v = rng() % n;
+                    edges.push_back({u, v, 1});
+                    u = v;
+                }
+                edges.push_back({u, start, 1});
+            }
+            CsrGraph csr = build_csr_from_edges(n, false, edges);
+            while (state.keep_running()) {
+                vector<int> path = euler_path(csr);
+                do_not_optimize(path);
+            }
+        });
+        runner.add("graph/dominators" + size, [n](BenchState& state) {
+            Graph g = make_bench_graph(n, n * 4, true, seed);
+            CsrGraph csr = build_csr(g);
+            while (state.keep_running()) {
+                vector<int> idom = dominator_tree(csr, 0);
+                do_not_optimize(idom);
+            }
+        });
+        runner.add("bfs/shortest_path_dag" + size, [csr_fixture](BenchState& state) {
+            const CsrGraph& g = csr_fixture();
+            while (state.keep_running()) {
+                ShortestPathDag dag = build_shortest_path_dag(g, 0);
+                do_not_optimize(dag);
+            }
+        });
+    }
+
+    // The original matrix engines scan a whole matrix row per vertex, O(V^2), so they only run on small graphs.
+    runner.add("bfs/bfs_shortest_path/50", [seed](BenchState& state) {
+        Graph g = make_bench_graph(50, 150, false, seed);
+        while (state.keep_running()) {
+            vector<int> path = bfs_shortest_path(g, 0, 49);
+            do_not_optimize(path);
+        }
+    });
+    runner.add("dfs/dfs_shortest_path/50", [seed](BenchState& state) {
+        Graph g = make_bench_graph(50, 150, false, seed);
+        while (state.keep_running()) {
+            vector<int> path = dfs_shortest_path(g, 0, 49);
+            do_not_optimize(path);
+        }
+    });
+    runner.add("reach/two_hop_dag/200000", [](BenchState& state) {
+        // Two planted communities with every edge oriented from the smaller to the larger vertex, so the graph is a DAG.
+        CommunityGraph g = stochastic_block_model({ 100000, 100000 }, { { 3e-5, 2e-6 }, { 2e-6, 3e-5 } }, seed);
+        vector<StreamEdge> edges;
+        for (int u = 0; u < g.graph.vertices; u++) {
+            g.graph.for_each_neighbor(u, [&](int v, int) { if (u < v) edges.push_back({u, v, 1}); });
+        }
+        ReachabilityIndex index;
+        index.build(build_csr_from_edges(g.graph.vertices, true, edges));
+        int u = 0, v = 0;
+        while (state.keep_running()) {
+            u = (u + 7919) % 200000;
+            v = (v + 104729) % 200000;
+            bool reachable = index.reachable(u, v);
+            do_not_optimize(reachable);
+        }
+    });
+    runner.add("generate/generate_graph/100", [](BenchState& state) {
+        while (state.keep_running()) {
+            Graph g = generate_graph(100, 100, 300, 300, 100, false, 1, 1, seed);
+            do_not_optimize(g);
+        }
+    });
+}
+
+/**
+ * Writes benchmark results as JSON, keeping the raw samples for later statistical comparison.
+ *
+ * @param path The path of the file to write.
+ * @param results The results to save.
+ * @return True on success, false if the file could not be written.
+ */
+bool save_benchmark_results(const string& path, const vector<BenchmarkResult>& results) {
+    ofstream out(path);
+    if (!out) return false;
+    out.precision(17);
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        string name;
+        for (char c : results[i].name) {
+            if (c == '"' || c == '\\') name += '\\';
+            name += c;
+        }
+        out << "    {\"name\": \"" << name << "\", \"iterations\": " << results[i].iterations << ", \"samples\": [";
+        for (size_t j = 0; j < results[i].samples.size(); j++) {
+            out << (j ? ", " : "") << results[i].samples[j];
+        }
+        out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+/**
+ * Reads benchmark results written by save_benchmark_results.
+ * Only the fields written by save_benchmark_results are understood.
+ *
+ * @param path The path of the file to read.
+ * @param results Receives the name, iterations and samples of every benchmark.
+ * @return True on success, false if the file could not be read or is malformed.
+ */
+bool load_benchmark_results(const string& path, vector<BenchmarkResult>& results) {
+    ifstream in(path);
+    if (!in) return false;
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    results.clear();
+    size_t pos = 0;
+    while ((pos = text.find("\"name\"", pos)) != string::npos) {
+        BenchmarkResult result;
+        pos = text.find('"', text.find(':', pos));
+        if (pos == string::npos) return false;
+        for (pos++; pos < text.size() && text[pos] != '"'; pos++) {
+            if (text[pos] == '\\') pos++;
+            result.name += text[pos];
+        }
+        size_t iterations = text.find("\"iterations\"", pos);
+        size_t samples = text.find("\"samples\"", pos);
+        size_t open = text.find('[', samples);
+        size_t close = text.find(']', open);
+        if (iterations == string::npos || samples == string::npos || open == string::npos || close == string::npos) return false;
+        result.iterations = atoll(text.c_str() + text.find(':', iterations) + 1);
+        for (size_t p = open + 1; p < close;) {
+            char* end = nullptr;
+            double value = strtod(text.c_str() + p, &end);
+            if (end == text.c_str() + p) break;
+            result.samples.push_back(value);
+            p = text.find_first_not_of(" ,\n", end - text.c_str());
+        }
+        if (result.samples.empty()) return false;
+        sort(result.samples.begin(), result.samples.end());
+        result.median = result.samples.size() % 2 ? result.samples[result.samples.size() / 2]
+            : (result.samples[result.samples.size() / 2 - 1] + result.samples[result.samples.size() / 2]) / 2;
+        results.push_back(result);
+        pos = close;
+    }
+    return true;
+}
+
+/**
+ * Computes the one-sided Mann-Whitney U test p-value for "current is slower than baseline".
+ * Small samples use the exact distribution of U, larger ones the normal approximation.
+ *
+ * @param baseline The baseline samples.
+ * @param current The current samples.
+ * @return The probability of a U statistic at least this large if both samples come from the same distribution.
+ */
+double mann_whitney_p_value(const vector<double>& baseline, const vector<double>& current) {
+    int n1 = (int)current.size();
+    int n2 = (int)baseline.size();
+    // U counts the pairs where the current sample is slower, ties count one half.
+    double u = 0;
+    for (double c : current) {
+        for (double b : baseline) u += c > b ? 1.0 : (c == b ? 0.5 : 0.0);
+    }
+    if (n1 + n2 <= 40) {
+        // ways[i][j][k]: number of orderings of i current and j baseline samples with U = k.
+        int max_u = n1 * n2;
+        vector<vector<vector<double>>> ways(n1 + 1, vector<vector<double>>(n2 + 1, vector<double>(max_u + 1, 0)));
+        for (int i = 0; i <= n1; i++) {
+            for (int j = 0; j <= n2; j++) {
+                if (i == 0 || j == 0) {
+                    ways[i][j][0] = 1;
+                    continue;
+                }
+                for (int k = 0; k <= i * j; k++) {
+                    // The largest sample is either a current one, beating all j baseline samples, or a baseline one.
+                    ways[i][j][k] = (k >= j ? ways[i - 1][j][k - j] : 0) + ways[i][j - 1][k];
+                }
+            }
+        }
+        double total = 0;
+        double tail = 0;
+        for (int k = 0; k <= max_u; k++) {
+            total += ways[n1][n2][k];
+            if (k >= u - 1e-9) tail += ways[n1][n2][k];
+        }
+        return tail / total;
+    }
+    double mean = n1 * n2 / 2.0;
+    double sd = sqrt(n1 * n2 * (n1 + n2 + 1) / 12.0);
+    double z = (u - 0.5 - mean) / sd;
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+/**
+ * Compares current results against a baseline and prints a verdict for every benchmark present in both.
+ * A benchmark regressed if its median slowed down by more than the threshold and the
+ * Mann-Whitney test says the slowdown is significant.
+ *
+ * @param baseline The baseline results.
+ * @param current The current results.
+ * @param threshold The tolerated relative slowdown of the median, 0.05 means 5%.
+ * @param alpha The significance level of the test.
+ * @return The number of regressed benchmarks.
+ */
+int compare_benchmark_results(const vector<BenchmarkResult>& baseline, const vector<BenchmarkResult>& current, double threshold, double alpha) {
+    int regressions = 0;
+    for (const BenchmarkResult& cur : current) {
+        const BenchmarkResult* base = nullptr;
+        for (const BenchmarkResult& b : baseline) {
+            if (b.name == cur.name) base = &b;
+        }
+        if (base == nullptr) {
+            cout << cur.name << ": not in baseline" << endl;
+            continue;
+        }
+        double change = cur.median / base->median - 1.0;
+        double p = mann_whitney_p_value(base->samples, cur.samples);
+        bool regressed = change > threshold && p < alpha;
+        if (regressed) regressions++;
+        cout << cur.name << string(cur.name.size() < 40 ? 40 - cur.name.size() : 1, ' ')
+            << (change >= 0 ? "+" : "") << change * 100 << "%  p=" << p
+            << (regressed ? "  REGRESSION" : "") << endl;
+    }
+    return regressions;
+}
+
+/**
+ * Runs the benchmark suite selected on the command line.
+ * Usage: --bench [filter] [--save file.json] [--compare file.json] [--threshold 0.05] [--alpha 0.05]
+ *        [--repetitions 10] [--min-time 0.1]
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return EXIT_FAILURE if a comparison found a regression or a file could not be used, EXIT_SUCCESS otherwise.
+ */
+int run_benchmarks(int argc, char* argv[]) {
+    string filter;
+    string save_path;
+    string compare_path;
+    double threshold = 0.05;
+    double alpha = 0.05;
+    int repetitions = 10;
+    double min_time = 0.1;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--save" && has_value) save_path = argv[++i];
+        else if (arg == "--compare" && has_value) compare_path = argv[++i];
+        else if (arg == "--threshold" && has_value) threshold = atof(argv[++i]);
+        else if (arg == "--alpha" && has_value) alpha = atof(argv[++i]);
+        else if (arg == "--repetitions" && has_value) repetitions = max(2, atoi(argv[++i]));
+        else if (arg == "--min-time" && has_value) min_time = atof(argv[++i]);
+        else filter = arg;
+    }
+
+    vector<BenchmarkResult> baseline;
+    if (!compare_path.empty() && !load_benchmark_results(compare_path, baseline)) {
+        cout << "Can not read baseline " << compare_path << endl;
+        return EXIT_FAILURE;
+    }
+
+    BenchmarkRunner runner;
+    register_benchmarks(runner);
+    vector<BenchmarkResult> results = runner.run(filter, min_time, repetitions);
+
+    if (!save_path.empty() && !save_benchmark_results(save_path, results)) {
+        cout << "Can not write results to " << save_path << endl;
+        return EXIT_FAILURE;
+    }
+    if (!compare_path.empty()) {
+        cout << endl << "Comparison against " << compare_path << ":" << endl;
+        int regressions = compare_benchmark_results(baseline, results, threshold, alpha);
+        cout << regressions << " regression(s)" << endl;
+        if (regressions > 0) return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        return run_benchmarks(argc, argv);
+    }
+    // --trace file.json dumps the timeline of the run, needs a build with GRAPH_TRACING defined.
+    string trace_path = argc > 2 && string(argv[1]) == "--trace" ? argv[2] : "";
+
+    srand(time(0));
+    int min_vertices = 10;
+    int max_vertices = 10;
+    int min_edges = 10;
+    int max_edges = 10;
+    int max_edges_per_vertex = 10;
+    int num_graphs = 10;
+    int source = 0;
+    int target = 0;
+
+
+    for (int i = 0; i < num_graphs; i++) {
+
+        int num_vertices = rand() % (max_vertices - min_vertices + 1) + min_vertices;
+        int num_edges = rand() % (max_edges - min_edges + 1) + min_edges;
+        Graph g = generate_graph(min_vertices, max_vertices, min_edges, max_edges, max_edges_per_vertex, false, 1, 1);
+        source = rand() % num_vertices;
+        target = rand() % num_vertices;
+
+
+
+        cout << "Adjacency matrix:" << endl;
+        g.print_adj_matrix();
+
+        cout << "Incidence matrix:" << endl;
+        g.print_inc_matrix();
+
+        cout << "Adjacency list:" << endl;
+        g.print_adj_list();
+
+        cout << "Graph " << i + 1 << " with " << num_vertices << " vertices and " << num_edges << " edges" << endl;
+        clock_t start_bfs = clock();
+        vector<int> bfs_path = bfs_shortest_path(g, source, target);
+        clock_t end_bfs = clock();
+        double time_bfs = (double)(end_bfs - start_bfs) / CLOCKS_PER_SEC;
+        cout << "BFS shortest path from vertex " << source << " to vertex " << target << ": ";
+        if (!bfs_path.empty()) {
+            for (int j = 0; j < bfs_path.size(); j++) {
+                cout << bfs_path[j] << " ";
+            }
+            cout << endl;
+        }
+        else {
+            cout << "Path does not exist" << endl;
+        }
+        cout << "BFS shortest path time: " << time_bfs << " seconds" << endl;
+
+        clock_t start_dfs = clock();
+        vector<int> dfs_path = dfs_shortest_path(g, source, target);
+        clock_t end_dfs = clock();
+        double time_dfs = (double)(end_dfs - start_dfs) / CLOCKS_PER_SEC;
+
+        cout << "DFS shortest path from vertex " << source << " to vertex " << target << ": ";
+        if (!dfs_path.empty()) {
+            for (int j = 0; j < dfs_path.size(); j++) {
+                cout << dfs_path[j] << " ";
+            }
+            cout << endl;
+        }
+        else {
+            cout << "Path does not exist" << endl;
+        }
+        cout << "DFS shortest path time: " << time_dfs << " seconds ";
+        cout << endl << endl << endl;
+
+    }
+    if (!trace_path.empty() && !trace_dump(trace_path)) {
+        cout << "Trace was not written, build with GRAPH_TRACING defined" << endl;
     }
     return EXIT_SUCCESS;
 }
\ No newline at end of file